@@ -19,6 +19,12 @@ if (-e "$output") {
 	unlink($output);
 }
 
+# Binary dumps are appended to DumpArchive= (if any) instead of $output
+my $archive = readLabelOrEmpty($templateInput,"DumpArchive=");
+if ($archive ne "" and -e "$archive") {
+	unlink($archive);
+}
+
 my $sectors = 0;
 for (my $nup = 0; $nup <= $total; ++$nup) {
 	for (my $ndown = 0; $ndown <= $total; ++$ndown) {
@@ -106,7 +112,15 @@ sub createVector
 sub readLabel
 {
 	my ($file,$label)=@_;
-	my $ret;
+	my $ret = readLabelOrEmpty($file,$label);
+	($ret ne "") or die "readLabel: Not found $label in $file\n";
+	return $ret;
+}
+
+sub readLabelOrEmpty
+{
+	my ($file,$label)=@_;
+	my $ret = "";
 	open(FILE,$file) or die "Cannot open $file: $!\n";
 	while(<FILE>) {
 		chomp;
@@ -118,6 +132,5 @@ sub readLabel
 
 	close(FILE);
 
-	defined($ret) or die "readLabel: Not found $label in $file\n";
 	return $ret;
 }
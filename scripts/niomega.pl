@@ -2,7 +2,6 @@
 
 use strict;
 use warnings;
-use Math::Trig;
 
 my ($template,$rootInput,$wbegin,$wend,$wstep,$wdelta,$orb1,$orb2,$orbitals,$spin) = @ARGV;
 my $obs = "c";
@@ -14,20 +13,14 @@ my $spins = "\"$spin,$spin\"";
 my $total = readLabel($template,"TotalNumberOfSites");
 my @data;
 
+my $input = createInput(0);
+my $grid = "\"$wbegin,$wend,$wstep,$wdelta\"";
+my $pairs = "\"".join(";",map {"$_,$_"} (0..$total-1))."\"";
+system("./lanczos -f $input -g $obs -s $spins -S $pairs -w $grid > $rootInput.comb 2>&1");
+print STDERR "$0: Created $rootInput.comb\n";
 for (my $i = 0; $i < $total; ++$i) {
-	my $input = createInput($i);
-	system("./lanczos -f $input -g $obs -s $spins &> $rootInput$i.comb");
-	print STDERR "$0: Created $rootInput$i.comb\n";
-	system("perl ../scripts/extractOrbitals.pl $orb1 $orb2 $orbitals < $rootInput$i.comb > $rootInput$i.comb2");
-	print STDERR "$0: Created $rootInput$i.comb2\n";
-	system("echo \"#SITES $i $i\" > $rootInput$i.cf");
-	my $cmd = "../../PsimagLite/drivers/continuedFractionCollection ";
-	$cmd .= "-f $rootInput$i.comb2 -b $wbegin ";
-	$cmd .= " -e $wend -s $wstep -d $wdelta >> $rootInput$i.cf";
-	system($cmd);
-	print STDERR "$0: Created $rootInput$i.cf\n";
 	my @temp;
-	readData(\@temp,"$rootInput$i.cf");
+	readGrid(\@temp,"$rootInput.comb",$i,$orb1,$orb2,$orbitals);
 	$data[$i] = \@temp;
 }
 
@@ -53,23 +46,43 @@ for (my $wi =0; $wi < $omegasTotal; ++$wi) {
 }
 
 
-sub readData
+# Reads omega, imag and real of orbitals orb1,orb2 from the #SpectralGrid i i block
+sub readGrid
 {
-	my ($a,$file) = @_;
+	my ($a,$file,$site,$orb1,$orb2,$orbitals) = @_;
+	($orb1 < $orbitals && $orb2 < $orbitals) or die "$0: orbital >= $orbitals\n";
+	my $pair = ($orb1 <= $orb2) ? "$orb1,$orb2" : "$orb2,$orb1";
 	open(FILE,"$file") or die "$0: Cannot open $file\n";
-	my $value;
+	my $column;
 	my $counter = 0;
+	my $inBlock = 0;
 	while(<FILE>) {
 		chomp;
-		next if (/^#/);
+		if (/^#SpectralGrid $site $site$/) {
+			$inBlock = 1;
+			next;
+		}
+
+		next unless ($inBlock);
+		if (/^#Columns/) {
+			my @temp = split;
+			for (my $j = 2; $j < scalar(@temp); ++$j) {
+				$column = $j - 2 if ($temp[$j] eq $pair);
+			}
+
+			defined($column) or die "$0: No orbitals $pair in $file\n";
+			next;
+		}
+
+		last if (/^#/);
 		my @temp = split;
-		next if (scalar(@temp) != 3);
-		$a->[$counter++] = \@temp;
+		last if (scalar(@temp) < 3 + 2*$column);
+		$a->[$counter++] = [$temp[0],$temp[1 + 2*$column],$temp[2 + 2*$column]];
 	}
 
 	close(FILE);
 
-	print STDERR "$0: Read $counter rows from $file\n";
+	print STDERR "$0: Read $counter rows for site $site from $file\n";
 }
 
 sub createInput
@@ -2,77 +2,69 @@
 
 use strict;
 use warnings;
-use Math::Trig;
 
-my ($template,$rootInput,$obs,$wbegin,$wend,$wstep,$wdelta,$orb1,$orb2,$orbitals,$spin) = @ARGV;
+my ($template,$rootInput,$obs,$wbegin,$wend,$wstep,$wdelta,$orb,$orbitals,$spin) = @ARGV;
 my $usage = "USAGE: $0 templateInput rootInput observable begin end step delta ";
-$usage .= "orb1 orb2 orbitals [spin]";
+$usage .= "orb orbitals [spin]";
 defined($orbitals) or die "$usage\n";
 defined($spin) or $spin = 0;
 my $spins = "\"$spin,$spin\"";
 
 my $total = readLabel($template,"TotalNumberOfSites");
 my $centralSite = int($total/2) - 1;
-my @data;
 
-for (my $i = 0; $i < $total; ++$i) {
-	my $input = createInput($i);
-	system("./lanczos -f $input -g $obs -s $spins &> $rootInput$i.comb");
-	print STDERR "$0: Created $rootInput$i.comb\n";
-	system("perl ../scripts/extractOrbitals.pl $orb1 $orb2 $orbitals < $rootInput$i.comb > $rootInput$i.comb2");
-	print STDERR "$0: Created $rootInput$i.comb2\n";
-	system("echo \"#SITES $centralSite $i\" > $rootInput$i.cf");
-	my $cmd = "../../PsimagLite/drivers/continuedFractionCollection ";
-	$cmd .= "-f $rootInput$i.comb2 -b $wbegin ";
-	$cmd .= " -e $wend -s $wstep -d $wdelta >> $rootInput$i.cf";
-	system($cmd);
-	print STDERR "$0: Created $rootInput$i.cf\n";
-	my @temp;
-	readData(\@temp,"$rootInput$i.cf");
-	$data[$i] = \@temp;
-}
+my $input = createInput(0);
+my $grid = "\"$wbegin,$wend,$wstep,$wdelta\"";
+system("./lanczos -f $input -g $obs -s $spins -q -w $grid > $rootInput.comb 2>&1");
+print STDERR "$0: Created $rootInput.comb\n";
+my @data;
+readGrid(\@data,"$rootInput.comb",$orb,$orbitals,$total);
 
-$_ = $data[0];
-my @omegas = @$_;
-my $omegasTotal = scalar(@omegas);
+my $omegasTotal = scalar(@data);
 print STDERR "#Omegas=".$omegasTotal."\n";
 for (my $wi =0; $wi < $omegasTotal; ++$wi) {
-	print "$omegas[$wi]->[0] ";
-	for (my $m = 0; $m < $total; ++$m) {
-		my ($sumr, $sumi) = (0,0);
-		my $q = 2.0*pi*$m/$total;
-		for (my $i = 0; $i < $total; ++$i) {
-			my $factor = ($i == $centralSite) ? 0.5 : 1;
-			$_ = $data[$i];
-			my @t = @$_;
-			my $t = $t[$wi];
-			my @temp = @$t;
-			next unless ($temp[0] == $omegas[$wi]->[0]);
-			my $arg = $q*($i-$centralSite);
-			my $cosval = cos($arg);
-			$sumi += $temp[1]*$cosval*$factor;
-			$sumr += $temp[2]*$cosval*$factor;
-		}
-
-		print "$sumi ";
-	}
-
-	print "\n";
+	$_ = $data[$wi];
+	my @temp = @$_;
+	print "@temp\n";
 }
 
-
-sub readData
+# Reads omega and the imag part for each momentum of orbital orb
+# from the #SpectralGrid momentum block
+sub readGrid
 {
-	my ($a,$file) = @_;
+	my ($a,$file,$orb,$orbitals,$total) = @_;
+	($orb < $orbitals) or die "$0: orbital >= $orbitals\n";
 	open(FILE,"$file") or die "$0: Cannot open $file\n";
-	my $value;
+	my @columns;
 	my $counter = 0;
+	my $inBlock = 0;
 	while(<FILE>) {
 		chomp;
-		next if (/^#/);
+		if (/^#SpectralGrid momentum/) {
+			$inBlock = 1;
+			next;
+		}
+
+		next unless ($inBlock);
+		if (/^#Columns/) {
+			my @temp = split;
+			for (my $j = 2; $j < scalar(@temp); ++$j) {
+				my ($m,$o) = split(/,/,$temp[$j]);
+				$columns[$m] = $j - 2 if ($o == $orb);
+			}
+
+			next;
+		}
+
+		last if (/^#/);
 		my @temp = split;
-		next if (scalar(@temp) != 3);
-		$a->[$counter++] = \@temp;
+		my @row = ($temp[0]);
+		for (my $m = 0; $m < $total; ++$m) {
+			# zero for momenta without weight
+			push @row, (defined($columns[$m])) ? $temp[1 + 2*$columns[$m]] : 0;
+		}
+
+		$a->[$counter++] = \@row;
 	}
 
 	close(FILE);
@@ -0,0 +1,343 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file BlockDavidson.h
+ *
+ *  The k lowest eigenpairs by block Davidson. Each iteration finds the
+ *  Ritz pairs (theta_c, x_c) of H in the subspace V, and, for those
+ *  not converged, adds the corrections (theta_c - D)^{-1} r_c, where
+ *  r_c = H x_c - theta_c x_c and D is the diagonal of H. All corrections
+ *  of an iteration are multiplied by H as one block. When V reaches its
+ *  largest size it is restarted with the 2k lowest Ritz vectors.
+ *
+ */
+#ifndef LANCZOS_BLOCK_DAVIDSON_H
+#define LANCZOS_BLOCK_DAVIDSON_H
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include "Vector.h"
+#include "Matrix.h"
+#include "Random48.h"
+
+namespace LanczosPlusPlus {
+
+/* PSIDOC BlockDavidson
+With SolverOptions=BlockDavidson the lowest states of each sector are
+computed by block Davidson, preconditioned with the diagonal of the
+Hamiltonian, with these labels:
+\begin{itemize}
+\item[DavidsonStates=] Number of lowest eigenpairs, 1 by default. Their
+energies are printed for each sector, and the lowest is the ground state.
+\item[DavidsonMaxBasis=] Largest size of the subspace; by default the
+larger of 20 and 6 times DavidsonStates=.
+\item[DavidsonTolerance=] Largest residual norm $|H\psi-E\psi|$ of a
+converged eigenpair, relative to $|E|$ when $|E|>1$; $10^{-8}$ by default.
+\item[DavidsonMaxIterations=] 200 by default.
+\end{itemize}
+*/
+template<typename RealType>
+struct DavidsonParams {
+
+	DavidsonParams() : states(1),maxBasis(0),tolerance(1e-8),maxIterations(200)
+	{}
+
+	template<typename InputType>
+	DavidsonParams(InputType& io)
+	    : states(1),maxBasis(0),tolerance(1e-8),maxIterations(200)
+	{
+		try {
+			io.readline(states,"DavidsonStates=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(maxBasis,"DavidsonMaxBasis=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(tolerance,"DavidsonTolerance=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(maxIterations,"DavidsonMaxIterations=");
+		} catch (std::exception&) {}
+
+		if (states == 0) states = 1;
+	}
+
+	SizeType states;
+	SizeType maxBasis;
+	RealType tolerance;
+	SizeType maxIterations;
+}; // struct DavidsonParams
+
+template<typename MatrixType, typename ComplexOrRealType>
+class BlockDavidson {
+
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+	typedef typename PsimagLite::Vector<VectorType>::Type VectorVectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Random48<RealType> RandomType;
+
+public:
+
+	typedef PsimagLite::Matrix<ComplexOrRealType> DenseMatrixType;
+	typedef DavidsonParams<RealType> ParamsType;
+
+	BlockDavidson(const MatrixType& matrix, const ParamsType& params)
+	    : matrix_(matrix),n_(matrix.rank()),params_(params),iterations_(0)
+	{}
+
+	//! Lowest eigenpair, after DavidsonStates= of them have converged
+	void computeGroundState(RealType& energy, VectorType& z)
+	{
+		VectorRealType eigs;
+		DenseMatrixType vecs;
+		lowest(eigs,vecs,params_.states);
+		energy = eigs[0];
+		z.resize(n_);
+		for (SizeType i = 0; i < n_; ++i)
+			z[i] = vecs(i,0);
+
+		std::cout<<"BlockDavidson: "<<iterations_<<" iterations, energies=";
+		for (SizeType c = 0; c < eigs.size(); ++c)
+			std::cout<<" "<<eigs[c];
+		std::cout<<"\n";
+	}
+
+	//! eigenvectors are the columns of vecs, like diag(...,'V') does
+	void lowest(VectorRealType& eigs, DenseMatrixType& vecs, SizeType k)
+	{
+		k = std::min(k,n_);
+		SizeType maxBasis = (params_.maxBasis > 0) ? params_.maxBasis :
+		                                             std::max<SizeType>(20,6*k);
+		maxBasis = std::min(std::max(maxBasis,3*k),n_);
+
+		VectorRealType d;
+		matrix_.diagonal(d);
+
+		VectorVectorType v;
+		VectorVectorType w;
+		VectorVectorType block(k,VectorType(n_));
+		RandomType rng(1234);
+		for (SizeType c = 0; c < k; ++c)
+			for (SizeType i = 0; i < n_; ++i)
+				block[c][i] = rng() - 0.5;
+
+		DenseMatrixType y;
+		VectorRealType theta;
+		VectorVectorType x(k,VectorType(n_));
+		VectorVectorType r(k,VectorType(n_));
+		for (iterations_ = 0; ; ++iterations_) {
+			append(v,w,block);
+			if (v.size() == 0)
+				throw PsimagLite::RuntimeError("BlockDavidson: empty subspace\n");
+
+			rayleighRitz(y,theta,v,w);
+
+			block.clear();
+			// fewer than k Ritz pairs when vectors were dropped in append;
+			// the space grows with random vectors until there are k
+			bool converged = (theta.size() >= k);
+			for (SizeType c = theta.size(); c < k; ++c) {
+				block.push_back(VectorType(n_));
+				for (SizeType i = 0; i < n_; ++i)
+					block.back()[i] = rng() - 0.5;
+			}
+
+			for (SizeType c = 0; c < k && c < theta.size(); ++c) {
+				combine(x[c],v,y,c);
+				combine(r[c],w,y,c);
+				for (SizeType i = 0; i < n_; ++i)
+					r[c][i] -= theta[c]*x[c][i];
+
+				RealType residual = norm(r[c]);
+				if (residual <= params_.tolerance*std::max(RealType(1),fabs(theta[c])))
+					continue;
+
+				converged = false;
+				for (SizeType i = 0; i < n_; ++i) {
+					RealType denominator = theta[c] - d[i];
+					if (fabs(denominator) < 1e-8) denominator = (denominator < 0) ? -1e-8 : 1e-8;
+					r[c][i] /= denominator;
+				}
+
+				block.push_back(r[c]);
+			}
+
+			bool full = (v.size() == n_);
+			if (converged || full || iterations_ == params_.maxIterations) {
+				if (!converged && !full)
+					std::cerr<<"BlockDavidson: not converged after "<<iterations_<<" iterations\n";
+				break;
+			}
+
+			if (v.size() + block.size() > maxBasis)
+				restart(v,w,y,std::min<SizeType>(2*k,theta.size()));
+		}
+
+		SizeType total = std::min(k,theta.size());
+		if (total < k) {
+			std::cerr<<"BlockDavidson: WARNING: only "<<total<<" of "<<k;
+			std::cerr<<" states were found\n";
+		}
+
+		eigs.resize(total);
+		vecs.resize(n_,total);
+		for (SizeType c = 0; c < total; ++c) {
+			eigs[c] = theta[c];
+			for (SizeType i = 0; i < n_; ++i)
+				vecs(i,c) = x[c][i];
+		}
+	}
+
+	SizeType iterations() const { return iterations_; }
+
+private:
+
+	// Orthonormalizes block against v and within itself, drops what is left
+	// without norm, and appends it to v and H times it to w, as one block
+	void append(VectorVectorType& v,
+	            VectorVectorType& w,
+	            VectorVectorType& block) const
+	{
+		VectorVectorType accepted;
+		for (SizeType c = 0; c < block.size(); ++c) {
+			VectorType& t = block[c];
+			RealType before = norm(t);
+			if (before == 0) continue;
+			for (SizeType pass = 0; pass < 2; ++pass) {
+				orthogonalize(t,v);
+				orthogonalize(t,accepted);
+			}
+
+			RealType after = norm(t);
+			if (after < 1e-10*before) continue;
+			scale(t,1.0/after);
+			accepted.push_back(t);
+		}
+
+		SizeType b = accepted.size();
+		if (b == 0) return;
+
+		DenseMatrixType yBlock(b,n_);
+		DenseMatrixType xBlock(b,n_);
+		for (SizeType c = 0; c < b; ++c)
+			for (SizeType i = 0; i < n_; ++i)
+				yBlock(c,i) = accepted[c][i];
+
+		matrix_.blockProduct(xBlock,yBlock);
+
+		for (SizeType c = 0; c < b; ++c) {
+			v.push_back(accepted[c]);
+			w.push_back(VectorType(n_));
+			VectorType& hv = w[w.size() - 1];
+			for (SizeType i = 0; i < n_; ++i)
+				hv[i] = xBlock(c,i);
+		}
+	}
+
+	static void rayleighRitz(DenseMatrixType& y,
+	                         VectorRealType& theta,
+	                         const VectorVectorType& v,
+	                         const VectorVectorType& w)
+	{
+		SizeType m = v.size();
+		DenseMatrixType g(m,m);
+		for (SizeType i = 0; i < m; ++i) {
+			for (SizeType j = i; j < m; ++j) {
+				ComplexOrRealType gij = scalarProduct(v[i],w[j]);
+				g(i,j) = gij;
+				g(j,i) = PsimagLite::conj(gij);
+			}
+		}
+
+		theta.resize(m);
+		diag(g,theta,'V');
+		y = g;
+	}
+
+	// Keeps the lowest Ritz vectors, and H times them
+	static void restart(VectorVectorType& v,
+	                    VectorVectorType& w,
+	                    const DenseMatrixType& y,
+	                    SizeType keep)
+	{
+		VectorVectorType v2(keep,VectorType(v[0].size()));
+		VectorVectorType w2(keep,VectorType(v[0].size()));
+		for (SizeType c = 0; c < keep; ++c) {
+			combine(v2[c],v,y,c);
+			combine(w2[c],w,y,c);
+		}
+
+		v.swap(v2);
+		w.swap(w2);
+	}
+
+	// result = sum_l y(l,c) v_l
+	static void combine(VectorType& result,
+	                    const VectorVectorType& v,
+	                    const DenseMatrixType& y,
+	                    SizeType c)
+	{
+		std::fill(result.begin(),result.end(),ComplexOrRealType(0));
+		for (SizeType l = 0; l < v.size(); ++l) {
+			ComplexOrRealType ylc = y(l,c);
+			const VectorType& vl = v[l];
+			for (SizeType i = 0; i < result.size(); ++i)
+				result[i] += ylc*vl[i];
+		}
+	}
+
+	static void orthogonalize(VectorType& t, const VectorVectorType& v)
+	{
+		for (SizeType l = 0; l < v.size(); ++l) {
+			ComplexOrRealType overlap = scalarProduct(v[l],t);
+			for (SizeType i = 0; i < t.size(); ++i)
+				t[i] -= overlap*v[l][i];
+		}
+	}
+
+	static ComplexOrRealType scalarProduct(const VectorType& a, const VectorType& b)
+	{
+		ComplexOrRealType sum = 0;
+		for (SizeType i = 0; i < a.size(); ++i)
+			sum += PsimagLite::conj(a[i])*b[i];
+		return sum;
+	}
+
+	static RealType norm(const VectorType& v)
+	{
+		return sqrt(PsimagLite::real(scalarProduct(v,v)));
+	}
+
+	static void scale(VectorType& v, RealType factor)
+	{
+		for (SizeType i = 0; i < v.size(); ++i)
+			v[i] *= factor;
+	}
+
+	const MatrixType& matrix_;
+	SizeType n_;
+	ParamsType params_;
+	SizeType iterations_;
+}; // class BlockDavidson
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_BLOCK_DAVIDSON_H
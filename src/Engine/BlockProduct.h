@@ -0,0 +1,111 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file BlockProduct.h
+ *
+ *  x += H y for a block of b vectors and a stored CRS matrix H, in one
+ *  sweep over the rows, so each matrix element is read once for all
+ *  vectors. Blocks are b x n dense matrices, one column per basis
+ *  state, so the b entries that a matrix element multiplies are
+ *  contiguous.
+ *
+ */
+#ifndef LANCZOS_BLOCK_PRODUCT_H
+#define LANCZOS_BLOCK_PRODUCT_H
+#include <algorithm>
+#include "Vector.h"
+#include "Matrix.h"
+#include "CrsMatrix.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+
+namespace LanczosPlusPlus {
+
+template<typename ComplexOrRealType>
+class BlockProduct {
+
+	typedef PsimagLite::CrsMatrix<ComplexOrRealType> SparseMatrixType;
+	typedef PsimagLite::Matrix<ComplexOrRealType> DenseMatrixType;
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	// One task per row
+	class Tasks {
+
+	public:
+
+		Tasks(const SparseMatrixType& matrix, DenseMatrixType& x, const DenseMatrixType& y)
+		    : matrix_(matrix),x_(x),y_(y)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			SizeType start = threadNum*blockSize;
+			SizeType end = std::min<SizeType>(start + blockSize,total);
+			SizeType b = y_.n_row();
+			for (SizeType i = start; i < end; ++i) {
+				ComplexOrRealType* xi = &(x_(0,i));
+				for (int k = matrix_.getRowPtr(i); k < matrix_.getRowPtr(i+1); ++k) {
+					ComplexOrRealType value = matrix_.getValue(k);
+					const ComplexOrRealType* yj = &(y_(0,matrix_.getCol(k)));
+					for (SizeType c = 0; c < b; ++c)
+						xi[c] += value*yj[c];
+				}
+			}
+		}
+
+	private:
+
+		const SparseMatrixType& matrix_;
+		DenseMatrixType& x_;
+		const DenseMatrixType& y_;
+	}; // class Tasks
+
+public:
+
+	static void apply(const SparseMatrixType& matrix,
+	                  DenseMatrixType& x,
+	                  const DenseMatrixType& y)
+	{
+		SizeType total = matrix.row();
+		if (total == 0 || y.n_row() == 0) return;
+
+		Tasks tasks(matrix,x,y);
+		PsimagLite::Parallelizer<Tasks> threaded(PsimagLite::Concurrency::npthreads,
+		                                         PsimagLite::MPI::COMM_WORLD);
+		threaded.loopCreate(total,tasks);
+	}
+
+	static void diagonal(VectorRealType& d, const SparseMatrixType& matrix)
+	{
+		SizeType total = matrix.row();
+		d.resize(total);
+		for (SizeType i = 0; i < total; ++i) {
+			d[i] = 0;
+			for (int k = matrix.getRowPtr(i); k < matrix.getRowPtr(i+1); ++k)
+				if (SizeType(matrix.getCol(k)) == i)
+					d[i] += PsimagLite::real(matrix.getValue(k));
+		}
+	}
+}; // class BlockProduct
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_BLOCK_PRODUCT_H
@@ -22,7 +22,13 @@ Please see full open source license included in file LICENSE.
 #include "ProgressIndicator.h"
 #include "CrsMatrix.h"
 #include "Vector.h"
+#include "FusedProduct.h"
+#include "BlockProduct.h"
+#include "LowestDense.h"
 #include "Matrix.h"
+#include "DumpOptions.h"
+#include "DeflatedLanczos.h"
+#include "SectorArchive.h"
 
 namespace LanczosPlusPlus {
 
@@ -38,6 +44,7 @@ class DefaultSymmetry  {
 public:
 
 	typedef GeometryType_ GeometryType;
+	typedef DumpOptions<RealType> DumpOptionsType;
 	typedef PsimagLite::CrsMatrix<ComplexOrRealType> SparseMatrixType;
 	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
 
@@ -57,6 +64,11 @@ public:
 		if (printMatrix_ && nrows > 40)
 				throw PsimagLite::RuntimeError("printMatrix: too big\n");
 
+		if (dumpMatrix_ && dumpOptions_.archive != "") {
+			dumpArchive(model);
+			return;
+		}
+
 		if (printMatrix_ || dumpMatrix_) {
 			std::cout<<"#LanczosPlusPlus: Basis for matrix\n";
 
@@ -71,17 +83,21 @@ public:
 
 			PsimagLite::Matrix<ComplexOrRealType> matrixCopy;
 			VectorRealType eigs;
-			fullDiag(eigs,matrixCopy);
+			if (dumpOptions_.truncated())
+				lowestDiag(eigs,matrixCopy);
+			else
+				fullDiag(eigs,matrixCopy);
 		}
 	}
 
-	void fullDiag(VectorRealType& eigs,MatrixType& fm) const
+	void setDumpOptions(const DumpOptionsType& dumpOptions)
 	{
-		if (matrixStored_.row() > 4900)
-			throw PsimagLite::RuntimeError("fullDiag too big\n");
+		dumpOptions_ = dumpOptions;
+	}
 
-		fm = matrixStored_.toDense();
-		diag(fm,eigs,'V');
+	void fullDiag(VectorRealType& eigs,MatrixType& fm) const
+	{
+		fullDiagNoPrint(eigs,fm);
 
 		if (printMatrix_ || dumpMatrix_) {
 			std::cout<<"#Eigenvalues\n";
@@ -91,6 +107,22 @@ public:
 		}
 	}
 
+	//! The k lowest eigenpairs only, by LAPACK's range driver
+	void lowestDense(VectorRealType& eigs,MatrixType& fm,SizeType k) const
+	{
+		LowestDense<ComplexOrRealType>::lowest(eigs,fm,matrixStored_,k);
+	}
+
+	// Lowest DumpStates= eigenpairs within the DumpWeightCutoff= window
+	void lowestDiag(VectorRealType& eigs,MatrixType& fm) const
+	{
+		lowestDiagNoPrint(eigs,fm);
+		std::cout<<"#Eigenvalues\n";
+		std::cout<<eigs;
+		std::cout<<"#Eigenvectors\n";
+		std::cout<<fm;
+	}
+
 	void transformMatrix(typename PsimagLite::Vector<SparseMatrixType>::Type&,
 	                     const SparseMatrixType&) const
 	{
@@ -115,11 +147,81 @@ public:
 		return matrixStored_.matrixVectorProduct(x,y);
 	}
 
+	//! x = a H y + b z in one sweep, returns <y|x>
+	template<typename SomeVectorType>
+	typename SomeVectorType::value_type fusedProduct(SomeVectorType& x,
+	                                                 const SomeVectorType& y,
+	                                                 const SomeVectorType& z,
+	                                                 RealType a,
+	                                                 RealType b,
+	                                                 SizeType threads) const
+	{
+		typedef FusedProduct<SparseMatrixType,SomeVectorType> FusedProductType;
+		return FusedProductType::apply(matrixStored_,x,y,z,a,b,threads);
+	}
+
+	//! x += H y for a block of vectors, one column per state
+	void blockProduct(MatrixType& x, const MatrixType& y) const
+	{
+		BlockProduct<ComplexOrRealType>::apply(matrixStored_,x,y);
+	}
+
+	void diagonal(VectorRealType& d) const
+	{
+		BlockProduct<ComplexOrRealType>::diagonal(d,matrixStored_);
+	}
+
 private:
 
+	template<typename SomeModelType>
+	void dumpArchive(const SomeModelType& model) const
+	{
+		typename SomeModelType::SectorArchiveWriterType writer(dumpOptions_.archive);
+		VectorRealType eigs;
+		MatrixType fm;
+		if (dumpOptions_.truncated())
+			lowestDiagNoPrint(eigs,fm);
+		else
+			fullDiagNoPrint(eigs,fm);
+
+		writer.setEigen(eigs,fm);
+		model.archiveOperators(writer);
+		writer.close();
+		std::cout<<"#LanczosPlusPlus: sector with "<<eigs.size()<<" states appended to ";
+		std::cout<<dumpOptions_.archive<<"\n";
+	}
+
+	void fullDiagNoPrint(VectorRealType& eigs,MatrixType& fm) const
+	{
+		if (matrixStored_.row() > 4900)
+			throw PsimagLite::RuntimeError("fullDiag too big\n");
+
+		fm = matrixStored_.toDense();
+		diag(fm,eigs,'V');
+	}
+
+	void lowestDiagNoPrint(VectorRealType& eigs,MatrixType& fm) const
+	{
+		typedef DeflatedLanczos<SparseMatrixType,ComplexOrRealType> DeflatedLanczosType;
+
+		DeflatedLanczosType deflatedLanczos(matrixStored_,matrixStored_.row());
+		deflatedLanczos.lowest(eigs,fm,dumpOptions_.states);
+
+		SizeType total = dumpOptions_.statesInWindow(eigs);
+		if (total < eigs.size()) {
+			eigs.resize(total);
+			MatrixType tmp(fm.n_row(),total);
+			for (SizeType j = 0; j < total; ++j)
+				for (SizeType i = 0; i < fm.n_row(); ++i)
+					tmp(i,j) = fm(i,j);
+			fm = tmp;
+		}
+	}
+
 	SparseMatrixType matrixStored_;
 	bool printMatrix_;
 	bool dumpMatrix_;
+	DumpOptionsType dumpOptions_;
 }; // class DefaultSymmetry
 } // namespace Dmrg
 
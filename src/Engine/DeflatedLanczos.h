@@ -0,0 +1,219 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file DeflatedLanczos.h
+ *
+ *  The k lowest eigenpairs of a sparse matrix by Lanczos with deflation:
+ *  eigenpair i is the lowest of (1-P)H(1-P), where P projects onto the
+ *  eigenvectors already found. Krylov vectors are kept orthogonal to them
+ *  and to each other, so degenerate states are found one by one.
+ *  Eigenpairs that do not converge in maxSteps are kept, and their
+ *  residuals are reported on std::cerr.
+ *
+ */
+#ifndef LANCZOS_DEFLATED_LANCZOS_H
+#define LANCZOS_DEFLATED_LANCZOS_H
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include "Vector.h"
+#include "Matrix.h"
+#include "Random48.h"
+#include "TypeToString.h"
+
+namespace LanczosPlusPlus {
+
+template<typename MatrixType, typename ComplexOrRealType>
+class DeflatedLanczos {
+
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+	typedef typename PsimagLite::Vector<VectorType>::Type VectorVectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Matrix<RealType> MatrixRealType;
+	typedef PsimagLite::Random48<RealType> RandomType;
+
+public:
+
+	typedef PsimagLite::Matrix<ComplexOrRealType> DenseMatrixType;
+
+	DeflatedLanczos(const MatrixType& matrix,
+	                SizeType n,
+	                SizeType maxSteps = 200,
+	                RealType tolerance = 1e-10)
+	    : matrix_(matrix),n_(n),maxSteps_(maxSteps),tolerance_(tolerance)
+	{}
+
+	//! eigenvectors are the columns of vecs, like diag(...,'V') does
+	void lowest(VectorRealType& eigs, DenseMatrixType& vecs, SizeType k)
+	{
+		k = std::min(k,n_);
+		found_.clear();
+		eigs.clear();
+		for (SizeType i = 0; i < k; ++i) {
+			VectorType v;
+			RealType e = 0;
+			if (!nextEigenpair(e,v,i)) break;
+			found_.push_back(v);
+			eigs.push_back(e);
+		}
+
+		sortEigenpairs(eigs);
+
+		vecs.resize(n_,found_.size());
+		for (SizeType j = 0; j < found_.size(); ++j)
+			for (SizeType i = 0; i < n_; ++i)
+				vecs(i,j) = found_[j][i];
+	}
+
+private:
+
+	// Returns false if the deflated space is empty
+	bool nextEigenpair(RealType& e, VectorType& v, SizeType index)
+	{
+		VectorVectorType krylov;
+		VectorRealType alpha;
+		VectorRealType beta;
+
+		VectorType q(n_);
+		RandomType rng(1234 + index);
+		for (SizeType i = 0; i < n_; ++i)
+			q[i] = rng() - 0.5;
+
+		project(q);
+		RealType nrm = norm(q);
+		if (nrm < 1e-10) return false;
+		scale(q,1.0/nrm);
+
+		VectorType w(n_);
+		MatrixRealType t;
+		VectorRealType ritz;
+		RealType residual = 0;
+		SizeType maxSteps = std::min(maxSteps_,n_ - found_.size());
+		for (SizeType j = 0; j < maxSteps; ++j) {
+			krylov.push_back(q);
+			std::fill(w.begin(),w.end(),ComplexOrRealType(0));
+			matrix_.matrixVectorProduct(w,krylov[j]);
+			alpha.push_back(PsimagLite::real(scalarProduct(krylov[j],w)));
+
+			project(w);
+			for (SizeType k = 0; k <= j; ++k) {
+				ComplexOrRealType overlap = scalarProduct(krylov[k],w);
+				for (SizeType i = 0; i < n_; ++i)
+					w[i] -= overlap*krylov[k][i];
+			}
+
+			RealType b = norm(w);
+			bool last = (b < 1e-12 || j + 1 == maxSteps);
+			// checking convergence costs a diagonalization of T
+			if (last || (j + 1) % 5 == 0) {
+				diagonalize(t,ritz,alpha,beta);
+				residual = b*fabs(t(j,0));
+				if (last || residual < tolerance_) break;
+			}
+
+			beta.push_back(b);
+			q = w;
+			scale(q,1.0/b);
+		}
+
+		if (residual >= tolerance_) {
+			std::cerr<<"DeflatedLanczos: WARNING: eigenpair "<<index;
+			std::cerr<<" not converged after "<<krylov.size()<<" steps, residual ";
+			std::cerr<<residual<<" tolerance "<<tolerance_<<"\n";
+		}
+
+		e = ritz[0];
+		v.resize(n_);
+		std::fill(v.begin(),v.end(),ComplexOrRealType(0));
+		for (SizeType k = 0; k < krylov.size(); ++k)
+			for (SizeType i = 0; i < n_; ++i)
+				v[i] += t(k,0)*krylov[k][i];
+
+		project(v);
+		scale(v,1.0/norm(v));
+		return true;
+	}
+
+	static void diagonalize(MatrixRealType& t,
+	                        VectorRealType& ritz,
+	                        const VectorRealType& alpha,
+	                        const VectorRealType& beta)
+	{
+		SizeType m = alpha.size();
+		t.resize(m,m);
+		t.setTo(0.0);
+		for (SizeType i = 0; i < m; ++i) {
+			t(i,i) = alpha[i];
+			if (i + 1 < m) t(i,i+1) = t(i+1,i) = beta[i];
+		}
+
+		ritz.resize(m);
+		diag(t,ritz,'V');
+	}
+
+	// v = (1-P)v
+	void project(VectorType& v) const
+	{
+		for (SizeType k = 0; k < found_.size(); ++k) {
+			ComplexOrRealType overlap = scalarProduct(found_[k],v);
+			for (SizeType i = 0; i < n_; ++i)
+				v[i] -= overlap*found_[k][i];
+		}
+	}
+
+	void sortEigenpairs(VectorRealType& eigs)
+	{
+		for (SizeType i = 0; i < eigs.size(); ++i) {
+			SizeType imin = i;
+			for (SizeType j = i + 1; j < eigs.size(); ++j)
+				if (eigs[j] < eigs[imin]) imin = j;
+			if (imin == i) continue;
+			std::swap(eigs[i],eigs[imin]);
+			found_[i].swap(found_[imin]);
+		}
+	}
+
+	static ComplexOrRealType scalarProduct(const VectorType& v, const VectorType& w)
+	{
+		ComplexOrRealType sum = 0;
+		for (SizeType i = 0; i < v.size(); ++i)
+			sum += PsimagLite::conj(v[i])*w[i];
+		return sum;
+	}
+
+	static RealType norm(const VectorType& v)
+	{
+		return sqrt(PsimagLite::real(scalarProduct(v,v)));
+	}
+
+	static void scale(VectorType& v, RealType factor)
+	{
+		for (SizeType i = 0; i < v.size(); ++i)
+			v[i] *= factor;
+	}
+
+	const MatrixType& matrix_;
+	SizeType n_;
+	SizeType maxSteps_;
+	RealType tolerance_;
+	VectorVectorType found_;
+}; // class DeflatedLanczos
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_DEFLATED_LANCZOS_H
@@ -0,0 +1,237 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file DiagonalCorrelators.h
+ *
+ *  Correlators of operators diagonal in the basis, in one pass over
+ *  the ground state. Each basis state is decoded into two occupation
+ *  bitplanes, up and down, with one bit per site and orbital, and
+ *  |psi|^2 is added to the pairs of set bits of UU, DD and UD, where
+ *  UD(x,y) = <n_{x up} n_{y down}>; the rest follows from these.
+ *
+ */
+#ifndef LANCZOS_DIAGONAL_CORRELATORS_H
+#define LANCZOS_DIAGONAL_CORRELATORS_H
+#include "Vector.h"
+#include "Matrix.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+#include "ProgramGlobals.h"
+
+namespace LanczosPlusPlus {
+
+template<typename ModelType>
+class DiagonalCorrelators {
+
+	typedef typename ModelType::RealType RealType;
+	typedef typename ModelType::BasisBaseType BasisType;
+	typedef typename BasisType::WordType WordType;
+	typedef typename ModelType::ComplexOrRealType ComplexOrRealType;
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Matrix<RealType> MatrixRealType;
+
+	struct Accumulators {
+
+		Accumulators(SizeType slots)
+		    : uu(slots,slots),dd(slots,slots),ud(slots,slots)
+		{}
+
+		MatrixRealType uu;
+		MatrixRealType dd;
+		MatrixRealType ud;
+	}; // struct Accumulators
+
+	// One task per basis state, with one set of accumulators per thread
+	class Tasks {
+
+	public:
+
+		Tasks(const DiagonalCorrelators& parent, const VectorType& psi)
+		    : parent_(parent),
+		      psi_(psi),
+		      acc_(PsimagLite::Concurrency::npthreads,Accumulators(parent.slots_))
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			Accumulators& acc = acc_[threadNum];
+			for (SizeType p = 0; p < blockSize; ++p) {
+				SizeType i = threadNum*blockSize + p;
+				if (i >= total) break;
+				RealType w = PsimagLite::real(PsimagLite::conj(psi_[i])*psi_[i]);
+				if (w == 0) continue;
+				WordType up = 0;
+				WordType down = 0;
+				parent_.bitplanes(up,down,i);
+				addPairs(acc.uu,up,up,w);
+				addPairs(acc.dd,down,down,w);
+				addPairs(acc.ud,up,down,w);
+			}
+		}
+
+		void sum(Accumulators& result) const
+		{
+			SizeType slots = result.uu.n_row();
+			for (SizeType t = 0; t < acc_.size(); ++t) {
+				for (SizeType x = 0; x < slots; ++x) {
+					for (SizeType y = 0; y < slots; ++y) {
+						result.uu(x,y) += acc_[t].uu(x,y);
+						result.dd(x,y) += acc_[t].dd(x,y);
+						result.ud(x,y) += acc_[t].ud(x,y);
+					}
+				}
+			}
+		}
+
+	private:
+
+		static void addPairs(MatrixRealType& m, WordType a, WordType b, RealType w)
+		{
+			for (WordType x = a; x; x &= (x - 1)) {
+				SizeType i = lowestBit(x);
+				for (WordType y = b; y; y &= (y - 1))
+					m(i,lowestBit(y)) += w;
+			}
+		}
+
+		static SizeType lowestBit(WordType x)
+		{
+			SizeType i = 0;
+			while (!(x & 1)) {
+				x >>= 1;
+				++i;
+			}
+
+			return i;
+		}
+
+		const DiagonalCorrelators& parent_;
+		const VectorType& psi_;
+		typename PsimagLite::Vector<Accumulators>::Type acc_;
+	}; // class Tasks
+
+public:
+
+	DiagonalCorrelators(const ModelType& model, const VectorType& psi)
+	    : model_(model),
+	      basis_(model.basis()),
+	      sites_(model.geometry().numberOfSites()),
+	      orbitals_(maxOrbitals(model)),
+	      slots_(sites_*orbitals_),
+	      isHeisenberg_(model.name().find("Heisenberg.h") != PsimagLite::String::npos),
+	      acc_(slots_)
+	{
+		if (slots_ > 8*sizeof(WordType))
+			throw PsimagLite::RuntimeError("DiagonalCorrelators: too many sites\n");
+
+		if (isHeisenberg_ && basis_.hilbertOneSite() != 2)
+			throw PsimagLite::RuntimeError("DiagonalCorrelators: only spin 1/2\n");
+
+		typedef PsimagLite::Parallelizer<Tasks> ParallelizerType;
+		Tasks tasks(*this,psi);
+		ParallelizerType threaded(PsimagLite::Concurrency::npthreads,
+		                          PsimagLite::MPI::COMM_WORLD);
+		threaded.loopCreate(psi.size(),tasks);
+		tasks.sum(acc_);
+	}
+
+	/* PSIDOC DiagonalCorrelators
+	With -d, lanczos prints the densities $\langle n_{x\uparrow}\rangle$ and
+	$\langle n_{x\downarrow}\rangle$, the double occupancy
+	$\langle n_{x\uparrow}n_{x\downarrow}\rangle$, and the matrices
+	$\langle n_x n_y\rangle$ and $\langle S^z_x S^z_y\rangle$, where
+	$x$ is site times the number of orbitals plus orbital.
+	All are computed in one pass over the ground state, threaded with Threads=.
+	*/
+	void printAll(std::ostream& os) const
+	{
+		VectorRealType nup(slots_,0);
+		VectorRealType ndown(slots_,0);
+		VectorRealType doubleOcc(slots_,0);
+		MatrixRealType nn(slots_,slots_);
+		MatrixRealType szsz(slots_,slots_);
+		for (SizeType x = 0; x < slots_; ++x) {
+			nup[x] = acc_.uu(x,x);
+			ndown[x] = acc_.dd(x,x);
+			doubleOcc[x] = acc_.ud(x,x);
+			for (SizeType y = 0; y < slots_; ++y) {
+				RealType same = acc_.uu(x,y) + acc_.dd(x,y);
+				RealType mixed = acc_.ud(x,y) + acc_.ud(y,x);
+				nn(x,y) = same + mixed;
+				szsz(x,y) = 0.25*(same - mixed);
+			}
+		}
+
+		os<<"#DensityUp\n";
+		os<<nup;
+		os<<"#DensityDown\n";
+		os<<ndown;
+		os<<"#DoubleOccupancy\n";
+		os<<doubleOcc;
+		os<<"#NN\n";
+		os<<nn;
+		os<<"#SzSz\n";
+		os<<szsz;
+	}
+
+private:
+
+	void bitplanes(WordType& up, WordType& down, SizeType i) const
+	{
+		WordType ket1 = basis_(i,ProgramGlobals::SPIN_UP);
+		WordType ket2 = basis_(i,ProgramGlobals::SPIN_DOWN);
+		WordType mask = 1;
+		for (SizeType site = 0; site < sites_; ++site) {
+			for (SizeType orb = 0; orb < orbitals_; ++orb, mask <<= 1) {
+				if (orb >= model_.orbitals(site)) continue;
+				SizeType n = basis_.getN(ket1,ket2,site,ProgramGlobals::SPIN_UP,orb);
+				if (n > 0) up |= mask;
+				if (isHeisenberg_) {
+					if (n == 0) down |= mask;
+					continue;
+				}
+
+				if (basis_.getN(ket1,ket2,site,ProgramGlobals::SPIN_DOWN,orb) > 0)
+					down |= mask;
+			}
+		}
+	}
+
+	static SizeType maxOrbitals(const ModelType& model)
+	{
+		SizeType res = 0;
+		for (SizeType i = 0; i < model.geometry().numberOfSites(); ++i)
+			if (res < model.orbitals(i)) res = model.orbitals(i);
+		return res;
+	}
+
+	const ModelType& model_;
+	const BasisType& basis_;
+	SizeType sites_;
+	SizeType orbitals_;
+	SizeType slots_;
+	bool isHeisenberg_;
+	Accumulators acc_;
+}; // class DiagonalCorrelators
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_DIAGONAL_CORRELATORS_H
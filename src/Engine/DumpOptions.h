@@ -0,0 +1,89 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+#ifndef LANCZOS_DUMP_OPTIONS_H
+#define LANCZOS_DUMP_OPTIONS_H
+#include "Vector.h"
+
+namespace LanczosPlusPlus {
+
+/* PSIDOC DumpOptions
+These labels control SolverOptions=dumpmatrix, whose output is read by thermal.
+By default all eigenstates of the sector are dumped.
+\begin{itemize}
+\item[DumpStates=] If larger than zero, only this number of lowest eigenstates is
+computed, with Lanczos and deflation, instead of full diagonalization.
+\item[DumpBeta=] Inverse temperature used for the weight cutoff below.
+\item[DumpWeightCutoff=] Of the states computed, only those with
+$\exp(-\beta(E-E_0))$ larger than this are dumped, where $E_0$ is the
+lowest energy of the sector.
+\item[DumpArchive=] If present, eigenvalues, eigenvectors and operators are
+appended in binary to this file instead of printed as text.
+thermal recognizes the archive and memory-maps it.
+Runs for different sectors can share the same archive file.
+\end{itemize}
+Because the cutoff is relative to the sector's own lowest energy, it never
+drops a state that the global cutoff would keep.
+*/
+template<typename RealType>
+struct DumpOptions {
+
+	DumpOptions() : states(0),beta(0),weightCutoff(0),archive("")
+	{}
+
+	template<typename InputType>
+	DumpOptions(InputType& io) : states(0),beta(0),weightCutoff(0),archive("")
+	{
+		try {
+			io.readline(states,"DumpStates=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(beta,"DumpBeta=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(weightCutoff,"DumpWeightCutoff=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(archive,"DumpArchive=");
+		} catch (std::exception&) {}
+	}
+
+	bool truncated() const { return (states > 0); }
+
+	// states must be ordered by energy
+	SizeType statesInWindow(const typename PsimagLite::Vector<RealType>::Type& eigs) const
+	{
+		if (beta <= 0 || weightCutoff <= 0 || eigs.size() == 0) return eigs.size();
+
+		for (SizeType i = 1; i < eigs.size(); ++i)
+			if (exp(-beta*(eigs[i] - eigs[0])) < weightCutoff) return i;
+
+		return eigs.size();
+	}
+
+	SizeType states;
+	RealType beta;
+	RealType weightCutoff;
+	PsimagLite::String archive;
+}; // struct DumpOptions
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_DUMP_OPTIONS_H
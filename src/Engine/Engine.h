@@ -21,6 +21,8 @@ Please see full open source license included in file LICENSE.
 #ifndef ENGINE_H_
 #define ENGINE_H_
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 #include "ProgressIndicator.h"
 #include "BLAS.h"
 #include "LanczosSolver.h"
@@ -28,6 +30,15 @@ Please see full open source license included in file LICENSE.
 #include "ProgramGlobals.h"
 #include "ParametersForSolver.h"
 #include "DefaultSymmetry.h"
+#include "DumpOptions.h"
+#include "SpectralGrid.h"
+#include "FusedLanczos.h"
+#include "ThickRestartLanczos.h"
+#include "BlockDavidson.h"
+#include "GroundStateFile.h"
+#include "LanczosCheckpoint.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
 #include "TypeToString.h"
 
 namespace LanczosPlusPlus {
@@ -46,12 +57,18 @@ public:
 	typedef typename ModelType::InputType InputType;
 	typedef typename ModelType::SparseMatrixType SparseMatrixType;
 	typedef typename ModelType::BasisBaseType BasisType;
+	typedef typename ModelType::OperatorCacheType OperatorCacheType;
+	typedef typename ModelType::OperatorIndexType OperatorIndexType;
 	typedef InternalProductTemplate<ModelType,SpecialSymmetryType> InternalProductType;
 	typedef DefaultSymmetry<typename ModelType::GeometryType,BasisType> DefaultSymmetryType;
 	typedef InternalProductTemplate<ModelType,DefaultSymmetryType> InternalProductDefaultType;
 	typedef typename SpecialSymmetryType::GeometryType GeometryType;
 	typedef typename GeometryType::ComplexOrRealType ComplexOrRealType;
 	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef FusedLanczos<InternalProductType,ComplexOrRealType> FusedLanczosType;
+	typedef FusedLanczos<InternalProductDefaultType,ComplexOrRealType> FusedLanczosDefaultType;
+	typedef ThickRestartLanczos<InternalProductType,ComplexOrRealType> ThickRestartLanczosType;
+	typedef BlockDavidson<InternalProductType,ComplexOrRealType> BlockDavidsonType;
 	typedef PsimagLite::Random48<RealType> RandomType;
 	typedef PsimagLite::ParametersForSolver<RealType> ParametersForSolverType;
 	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
@@ -67,6 +84,7 @@ public:
 	typedef std::pair<SizeType,SizeType> PairType;
 	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
 	typedef typename PsimagLite::Vector<PsimagLite::String>::Type VectorStringType;
+	typedef SpectralGrid<RealType> SpectralGridType;
 
 	// ContF needs to support concurrency FIXME
 	static const SizeType parallelRank_ = 0;
@@ -76,13 +94,19 @@ public:
 
 	Engine(const ModelType& model,
 	       SizeType,
-	       InputType& io)
+	       InputType& io,
+	       const GroundStateFileParams& gsFile = GroundStateFileParams())
 	    : model_(model),
 	      progress_("Engine"),
 	      io_(io),
-	      options_("")
+	      options_(""),
+	      fused_(false),
+	      twoPass_(false),
+	      gsFile_(gsFile)
 	{
 		io_.readline(options_,"SolverOptions=");
+		fused_ = (options_.find("FusedLanczos") != PsimagLite::String::npos);
+		twoPass_ = (options_.find("TwoPassLanczos") != PsimagLite::String::npos);
 		computeGroundState();
 	}
 
@@ -104,12 +128,13 @@ public:
 	                      int isite,
 	                      int jsite,
 	                      const PsimagLite::Vector<PairType>::Type& spins,
-	                      const PairType& orbs) const
+	                      const PairType& orbs,
+	                      SpectralGridType* grid = 0) const
 	{
 		std::cout<<"orbitals="<<orbs.first<<" "<<orbs.second<<"\n";
 		for (SizeType i=0;i<spins.size();i++) {
 			std::cout<<"spins="<<spins[i].first<<" "<<spins[i].second<<"\n";
-			spectralFunction(cfCollection,vstr,what2,isite,jsite,spins[i],orbs);
+			spectralFunction(cfCollection,vstr,what2,isite,jsite,spins[i],orbs,grid);
 		}
 	}
 
@@ -124,7 +149,8 @@ public:
 	                      int isite,
 	                      int jsite,
 	                      const PairType& spins,
-	                      const PairType& orbs) const
+	                      const PairType& orbs,
+	                      SpectralGridType* grid = 0) const
 	{
 		if (spins.first!=spins.second) {
 			PsimagLite::String str(__FILE__);
@@ -148,7 +174,7 @@ public:
 				std::pair<SizeType,SizeType> newParts(0,0);
 				if (!model_.hasNewParts(newParts,operatorLabel,spins.first,orbs)) continue;
 				// Create new bases
-				basisNew = model_.createBasis(newParts.first,newParts.second);
+				basisNew = &model_.sectorBasis(newParts);
 			} else {
 				basisNew = &model_.basis();
 			}
@@ -173,7 +199,7 @@ public:
 				std::cerr<<"spectralFunction: modifVector==0, type="<<type<<"\n";
 			}
 
-			calcSpectral(cf,operatorLabel,modifVector,matrix,type,spins.first,isDiagonal);
+			calcSpectral(cf,operatorLabel,modifVector,matrix,type,orbs,isDiagonal,grid);
 			PsimagLite::String str = ttos(spins.first) + "," + ttos(type) + ",";
 			str += ttos(orbs.first) + "," + ttos(orbs.second);
 			vstr.push_back(str);
@@ -181,6 +207,199 @@ public:
 		}
 	}
 
+	//! Calc G(isite,jsite) for all sitePairs, with one cfCollection, vstr and grid per pair
+	template<typename VectorContinuedFractionCollectionType>
+	void spectralFunctionBatch(VectorContinuedFractionCollectionType& cfCollections,
+	                           typename PsimagLite::Vector<VectorStringType>::Type& vstrs,
+	                           SizeType what2,
+	                           const PsimagLite::Vector<PairType>::Type& sitePairs,
+	                           const PsimagLite::Vector<PairType>::Type& spins,
+	                           const PairType& orbs,
+	                           typename PsimagLite::Vector<SpectralGridType>::Type* grids) const
+	{
+		std::cout<<"orbitals="<<orbs.first<<" "<<orbs.second<<"\n";
+		for (SizeType i=0;i<spins.size();i++) {
+			std::cout<<"spins="<<spins[i].first<<" "<<spins[i].second<<"\n";
+			spectralFunctionBatch(cfCollections,vstrs,what2,sitePairs,spins[i],orbs,grids);
+		}
+	}
+
+	/* PSIDOC SpectralFunctionBatch
+	With -S ``i1,j1;i2,j2;...'' or -S all, $G_{ij}$ is computed for each pair of sites
+	in one run, instead of for TSPSites only; all means all pairs with $i\le j$.
+	The vectors $O_i|gs\rangle$ are computed once per site and kept, and each
+	continued fraction, with vector $O_i|gs\rangle\pm O_j|gs\rangle$, is a task for
+	the Threads= threads. The output for each pair is the same as that of a run with
+	TSPSites set to that pair.
+	*/
+	template<typename VectorContinuedFractionCollectionType>
+	void spectralFunctionBatch(VectorContinuedFractionCollectionType& cfCollections,
+	                           typename PsimagLite::Vector<VectorStringType>::Type& vstrs,
+	                           SizeType what2,
+	                           const PsimagLite::Vector<PairType>::Type& sitePairs,
+	                           const PairType& spins,
+	                           const PairType& orbs,
+	                           typename PsimagLite::Vector<SpectralGridType>::Type* grids) const
+	{
+		typedef typename VectorContinuedFractionCollectionType::value_type
+		        ContinuedFractionCollectionType;
+		typedef typename ContinuedFractionCollectionType::ContinuedFractionType
+		        ContinuedFractionType;
+		typedef typename PairTasks::VectorVectorType VectorVectorType;
+		typedef PsimagLite::Parallelizer<PairTasks> ParallelizerType;
+
+		if (spins.first!=spins.second) {
+			PsimagLite::String str(__FILE__);
+			str += " " + ttos(__LINE__) + "\n";
+			str += "spectralFunctionBatch: no support yet for off-diagonal spin\n";
+			throw std::runtime_error(str.c_str());
+		}
+
+		SizeType npairs = sitePairs.size();
+		SizeType nsites = model_.geometry().numberOfSites();
+		bool onlyFirstIfSameSite = (model_.name()=="Tj1Orb.h");
+		bool sameOrbital = (orbs.first == orbs.second);
+		ParametersForSolverType params(io_,"Spectral");
+		SpectralChains chains(4*npairs,fused_);
+
+		for (SizeType parity = 0; parity < 2; ++parity) {
+			SizeType operatorLabel = (parity) ?  what2 : ProgramGlobals::transposeConjugate(what2);
+			const BasisType* basisNew = &model_.basis();
+			if (ProgramGlobals::needsNewBasis(operatorLabel)) {
+				std::pair<SizeType,SizeType> newParts(0,0);
+				if (!model_.hasNewParts(newParts,operatorLabel,spins.first,orbs)) continue;
+				basisNew = &model_.sectorBasis(newParts);
+			}
+
+			VectorVectorType first(nsites);
+			VectorVectorType second((sameOrbital) ? 0 : nsites);
+			for (SizeType p = 0; p < npairs; ++p) {
+				cacheModifiedState(first,operatorLabel,*basisNew,sitePairs[p].first,
+				                   spins.first,orbs.first);
+				cacheModifiedState((sameOrbital) ? first : second,operatorLabel,*basisNew,
+				                   sitePairs[p].second,spins.first,orbs.second);
+			}
+
+			DefaultSymmetryType symm(*basisNew,model_.geometry(),"");
+			InternalProductDefaultType matrix(model_,*basisNew,symm);
+			PairTasks tasks(matrix,
+			                params,
+			                sitePairs,
+			                first,
+			                (sameOrbital) ? first : second,
+			                parity,
+			                onlyFirstIfSameSite,
+			                sameOrbital,
+			                chains);
+			ParallelizerType threaded(PsimagLite::Concurrency::npthreads,
+			                          PsimagLite::MPI::COMM_WORLD);
+			threaded.loopCreate(2*npairs,tasks);
+		}
+
+		for (SizeType p = 0; p < npairs; ++p) {
+			bool isDiagonal = (sitePairs[p].first == sitePairs[p].second && sameOrbital);
+			for (SizeType type = 0; type < 4; ++type) {
+				SizeType t = 4*p + type;
+				if (!chains.done(t)) continue;
+				if (chains.weight(t)<1e-10) {
+					std::cerr<<"spectralFunctionBatch: modifVector==0, type="<<type<<"\n";
+				}
+
+				SizeType operatorLabel = (type&1) ?  what2 : ProgramGlobals::transposeConjugate(what2);
+				int s = 1;
+				RealType s2 = 1;
+				spectralSigns(s,s2,operatorLabel,type,isDiagonal);
+				RealType weight = chains.weight(t)*s2;
+				ContinuedFractionType cf(cfCollections[p].freqType());
+				cf.set(chains.ab(t),chains.reortho(t),gsEnergy_,weight,s);
+				if (grids) (*grids)[p].push(chains.ab(t),gsEnergy_,weight,s,orbs);
+				PsimagLite::String str = ttos(spins.first) + "," + ttos(type) + ",";
+				str += ttos(orbs.first) + "," + ttos(orbs.second);
+				vstrs[p].push_back(str);
+				cfCollections[p].push(cf);
+			}
+		}
+	}
+
+	/* PSIDOC MomentumSpectralFunctions
+	With -q, the spectral function of label is computed in momentum space,
+	$\langle O^\dagger_q (z-H)^{-1} O_q\rangle$ with
+	$O_q=L^{-1/2}\sum_r e^{iqr} O_r$ and $q=2\pi k/L$ for $k=0,\ldots,L-1$,
+	where the position r is the site index, so that sites are taken along a chain;
+	the other type uses $O^\dagger_q=L^{-1/2}\sum_r e^{-iqr} O^\dagger_r$.
+	The ground state is computed once, and the continued fractions of all q are
+	computed in parallel with Threads= threads. When Hamiltonian and operators are
+	real, $O_q$ is split into its cosine and sine parts, which give two fractions per q
+	that are to be added. The label of each fraction is spin,type,orbital,k.
+	With -w or -m, there is a single grid block, \verb!#SpectralGrid momentum!,
+	whose columns are k,orbital.
+	*/
+	template<typename ContinuedFractionCollectionType>
+	void momentumSpectralFunction(ContinuedFractionCollectionType& cfCollection,
+	                              VectorStringType& vstr,
+	                              SizeType what2,
+	                              SizeType spin,
+	                              SizeType orb,
+	                              SpectralGridType* grid = 0) const
+	{
+		typedef typename ContinuedFractionCollectionType::ContinuedFractionType
+		        ContinuedFractionType;
+		typedef PsimagLite::Parallelizer<MomentumTasks> ParallelizerType;
+
+		SizeType nsites = model_.geometry().numberOfSites();
+		SizeType parts = fourierParts(ComplexOrRealType());
+		ParametersForSolverType params(io_,"Spectral");
+
+		for (SizeType type = 0; type < 2; ++type) {
+			SizeType operatorLabel = (type&1) ?  what2 : ProgramGlobals::transposeConjugate(what2);
+			const BasisType* basisNew = &model_.basis();
+			if (ProgramGlobals::needsNewBasis(operatorLabel)) {
+				std::pair<SizeType,SizeType> newParts(0,0);
+				PairType orbs(orb,orb);
+				if (!model_.hasNewParts(newParts,operatorLabel,spin,orbs)) continue;
+				basisNew = &model_.sectorBasis(newParts);
+			}
+
+			DefaultSymmetryType symm(*basisNew,model_.geometry(),"");
+			InternalProductDefaultType matrix(model_,*basisNew,symm);
+			for (SizeType r = 0; r < nsites; ++r)
+				if (orb < model_.orbitals(r))
+					prepareModifiedState(operatorLabel,*basisNew,r,spin,orb);
+
+			// O^dagger_q carries the conjugate phase e^{-iqr}
+			RealType phaseSign = (type&1) ? 1 : -1;
+			SpectralChains chains(nsites*parts,fused_);
+			MomentumTasks tasks(*this,
+			                    matrix,
+			                    *basisNew,
+			                    params,
+			                    operatorLabel,
+			                    spin,
+			                    orb,
+			                    phaseSign,
+			                    chains);
+			ParallelizerType threaded(PsimagLite::Concurrency::npthreads,
+			                          PsimagLite::MPI::COMM_WORLD);
+			threaded.loopCreate(nsites*parts,tasks);
+
+			int s = 1;
+			RealType s2 = 1;
+			spectralSigns(s,s2,operatorLabel,type,true);
+			for (SizeType t = 0; t < nsites*parts; ++t) {
+				if (!chains.done(t)) continue;
+				SizeType k = t/parts;
+				RealType weight = chains.weight(t)*s2;
+				ContinuedFractionType cf(cfCollection.freqType());
+				cf.set(chains.ab(t),chains.reortho(t),gsEnergy_,weight,s);
+				if (grid) grid->push(chains.ab(t),gsEnergy_,weight,s,PairType(k,orb));
+				PsimagLite::String str = ttos(spin) + "," + ttos(type) + ",";
+				str += ttos(orb) + "," + ttos(k);
+				vstr.push_back(str);
+				cfCollection.push(cf);
+			}
+		}
+	}
+
 	void twoPoint(PsimagLite::Matrix<typename VectorType::value_type>& result,
 	              SizeType what2,
 	              const PsimagLite::Vector<PairType>::Type& spins,
@@ -195,12 +414,19 @@ public:
 
 	/* PSIDOC TwoPointCorrelations
 	Here we document the two-point correlations
+	$\langle O^\dagger_j O_i\rangle$ in row i and column j. Each $O_i|gs\rangle$
+	is computed once, in parallel with Threads= threads, as a column of a dense
+	panel, and all correlations are the product $V_2^\dagger V_1$ of panels. TwoPointBlockSize= in
+	the input limits the sites per panel, and so the memory, to that number
+	times the size of the basis; the default is all sites.
 	*/
 	void twoPoint(PsimagLite::Matrix<typename VectorType::value_type>& result,
 	              SizeType what2,
 	              const PairType& spins,
 	              const PairType& orbs) const
 	{
+		typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
+
 		const BasisType* basisNew = 0;
 
 		if (ProgramGlobals::needsNewBasis(what2)) {
@@ -215,7 +441,7 @@ public:
 			std::pair<SizeType,SizeType> newParts(0,0);
 			if (!model_.hasNewParts(newParts,what2,spins.first,orbs)) return;
 
-			basisNew = model_.createBasis(newParts.first,newParts.second);
+			basisNew = &model_.sectorBasis(newParts);
 
 			std::cerr<<"basisNew.size="<<basisNew->size()<<" ";
 			std::cerr<<"newparts.first="<<newParts.first<<" ";
@@ -230,29 +456,354 @@ public:
 			for (SizeType jsite=0;jsite<total;jsite++)
 				result(isite,jsite) = -100;
 
-		RealType isign = 1.0;
+		VectorSizeType sites1;
+		VectorSizeType sites2;
+		for (SizeType site = 0; site < total; ++site) {
+			if (orbs.first < model_.orbitals(site)) sites1.push_back(site);
+			if (orbs.second < model_.orbitals(site)) sites2.push_back(site);
+		}
+
+		SizeType blockSize = total;
+		try {
+			io_.readline(blockSize,"TwoPointBlockSize=");
+		} catch (std::exception&) {}
 
+		if (blockSize == 0) blockSize = total;
+
+		bool samePanels = (orbs.first == orbs.second && spins.first == spins.second);
+		SizeType n = basisNew->size();
 		typename VectorType::value_type sum = 0;
 		std::cout<<"orbs="<<orbs.first<<" "<<orbs.second<<"\n";
-		for (SizeType isite=0;isite<total;isite++) {
-			VectorType modifVector1(basisNew->size(),0);
-			if (orbs.first>=model_.orbitals(isite)) continue;
-			accModifiedState(modifVector1,what2,*basisNew,gsVector_,
-			                 isite,spins.first,orbs.first,isign);
-			for (SizeType jsite=0;jsite<total;jsite++) {
-				VectorType modifVector2(basisNew->size(),0);
-				if (orbs.second>=model_.orbitals(jsite)) continue;
-				accModifiedState(modifVector2,what2,*basisNew,gsVector_,
-				                 jsite,spins.second,orbs.second,isign);
-				result(isite,jsite) =  modifVector2*modifVector1;
-				if (isite==jsite) sum += result(isite,isite);
+		for (SizeType i0 = 0; i0 < sites1.size(); i0 += blockSize) {
+			SizeType ni = std::min<SizeType>(blockSize,sites1.size() - i0);
+			MatrixType panel1(n,ni);
+			fillPanel(panel1,what2,*basisNew,sites1,i0,spins.first,orbs.first);
+			for (SizeType j0 = 0; j0 < sites2.size(); j0 += blockSize) {
+				SizeType nj = std::min<SizeType>(blockSize,sites2.size() - j0);
+				bool reuse = (samePanels && i0 == j0);
+				MatrixType panel2((reuse) ? 0 : n,(reuse) ? 0 : nj);
+				if (!reuse)
+					fillPanel(panel2,what2,*basisNew,sites2,j0,spins.second,orbs.second);
+				const MatrixType& panel = (reuse) ? panel1 : panel2;
+
+				// block(j,i) = <O_j gs|O_i gs>, the conjugate is on the second panel
+				MatrixType block(nj,ni);
+				if (n > 0)
+					psimag::BLAS::GEMM('C','N',nj,ni,n,1.0,&(panel(0,0)),n,
+					                   &(panel1(0,0)),n,0.0,&(block(0,0)),nj);
+
+				for (SizeType i = 0; i < ni; ++i) {
+					for (SizeType j = 0; j < nj; ++j) {
+						SizeType isite = sites1[i0 + i];
+						SizeType jsite = sites2[j0 + j];
+						result(isite,jsite) = block(j,i);
+						if (isite==jsite) sum += result(isite,isite);
+					}
+				}
 			}
 		}
+
 		std::cout<<"MatrixDiagonal = "<<sum<<"\n";
 	}
 
 private:
 
+	// Lanczos chains computed by the tasks below, one per slot
+	class SpectralChains {
+
+	public:
+
+		SpectralChains(SizeType total, bool fused)
+		    : ab_(total),reortho_(total),weight_(total,0),done_(total,0),fused_(fused)
+		{}
+
+		void compute(SizeType t,
+		             const InternalProductDefaultType& matrix,
+		             const ParametersForSolverType& params,
+		             const VectorType& modifVector)
+		{
+			if (fused_) {
+				FusedLanczosDefaultType fusedLanczos(matrix,params.steps,params.tolerance,1);
+				fusedLanczos.decomposition(modifVector,ab_[t]);
+			} else {
+				LanczosSolverDefaultType lanczosSolver(matrix,params);
+				lanczosSolver.decomposition(modifVector,ab_[t]);
+				reortho_[t] = lanczosSolver.reorthogonalizationMatrix();
+			}
+
+			weight_[t] = PsimagLite::real(modifVector*modifVector);
+			done_[t] = 1;
+		}
+
+		bool done(SizeType t) const { return (done_[t] > 0); }
+
+		const TridiagonalMatrixType& ab(SizeType t) const { return ab_[t]; }
+
+		const MatrixRealType& reortho(SizeType t) const { return reortho_[t]; }
+
+		RealType weight(SizeType t) const { return weight_[t]; }
+
+	private:
+
+		typename PsimagLite::Vector<TridiagonalMatrixType>::Type ab_;
+		typename PsimagLite::Vector<MatrixRealType>::Type reortho_;
+		VectorRealType weight_;
+		PsimagLite::Vector<SizeType>::Type done_;
+		bool fused_;
+	}; // class SpectralChains
+
+	// One task per momentum, and per cosine or sine part for real vectors
+	class MomentumTasks {
+
+	public:
+
+		MomentumTasks(const Engine& engine,
+		              const InternalProductDefaultType& matrix,
+		              const BasisType& basisNew,
+		              const ParametersForSolverType& params,
+		              SizeType operatorLabel,
+		              SizeType spin,
+		              SizeType orb,
+		              RealType phaseSign,
+		              SpectralChains& chains)
+		    : engine_(engine),
+		      matrix_(matrix),
+		      basisNew_(basisNew),
+		      params_(params),
+		      operatorLabel_(operatorLabel),
+		      spin_(spin),
+		      orb_(orb),
+		      phaseSign_(phaseSign),
+		      chains_(chains)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			const ModelType& model = engine_.model_;
+			SizeType nsites = model.geometry().numberOfSites();
+			SizeType parts = fourierParts(ComplexOrRealType());
+			RealType norm = 1.0/sqrt(static_cast<RealType>(nsites));
+			for (SizeType p = 0; p < blockSize; ++p) {
+				SizeType t = threadNum*blockSize + p;
+				if (t >= total) break;
+				SizeType k = t/parts;
+				SizeType part = t % parts;
+				RealType q = phaseSign_*2.0*M_PI*k/nsites;
+				VectorType modifVector(basisNew_.size(),0);
+				for (SizeType r = 0; r < nsites; ++r) {
+					if (orb_ >= model.orbitals(r)) continue;
+					ComplexOrRealType factor = 0;
+					fourierFactor(factor,q*r,part);
+					engine_.accModifiedState(modifVector,
+					                         operatorLabel_,
+					                         basisNew_,
+					                         engine_.gsVector_,
+					                         r,
+					                         spin_,
+					                         orb_,
+					                         factor*norm,
+					                         1,
+					                         true);
+				}
+
+				// the sine part vanishes at q=0 and q=pi
+				if (PsimagLite::real(modifVector*modifVector) < 1e-10) continue;
+				chains_.compute(t,matrix_,params_,modifVector);
+			}
+		}
+
+	private:
+
+		const Engine& engine_;
+		const InternalProductDefaultType& matrix_;
+		const BasisType& basisNew_;
+		const ParametersForSolverType& params_;
+		SizeType operatorLabel_;
+		SizeType spin_;
+		SizeType orb_;
+		RealType phaseSign_;
+		SpectralChains& chains_;
+	}; // class MomentumTasks
+
+	// One task per site pair and type of the same operator label, the
+	// modified vectors are combinations of the cached O_i|gs>
+	class PairTasks {
+
+	public:
+
+		typedef typename PsimagLite::Vector<VectorType>::Type VectorVectorType;
+
+		PairTasks(const InternalProductDefaultType& matrix,
+		          const ParametersForSolverType& params,
+		          const PsimagLite::Vector<PairType>::Type& sitePairs,
+		          const VectorVectorType& first,
+		          const VectorVectorType& second,
+		          SizeType parity,
+		          bool onlyFirstIfSameSite,
+		          bool sameOrbital,
+		          SpectralChains& chains)
+		    : matrix_(matrix),
+		      params_(params),
+		      sitePairs_(sitePairs),
+		      first_(first),
+		      second_(second),
+		      parity_(parity),
+		      onlyFirstIfSameSite_(onlyFirstIfSameSite),
+		      sameOrbital_(sameOrbital),
+		      chains_(chains)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			for (SizeType p = 0; p < blockSize; ++p) {
+				SizeType t = threadNum*blockSize + p;
+				if (t >= total) break;
+				SizeType pairIndex = t/2;
+				SizeType type = 2*(t % 2) + parity_;
+				SizeType isite = sitePairs_[pairIndex].first;
+				SizeType jsite = sitePairs_[pairIndex].second;
+				bool isDiagonal = (isite == jsite && sameOrbital_);
+				if (isDiagonal && type > 1) continue;
+
+				VectorType modifVector = first_[isite];
+				if (!onlyFirstIfSameSite_ || isite != jsite) {
+					RealType isign = (type > 1) ? -1.0 : 1.0;
+					const VectorType& v = second_[jsite];
+					for (SizeType i = 0; i < modifVector.size(); ++i)
+						modifVector[i] += isign*v[i];
+				}
+
+				chains_.compute(4*pairIndex + type,matrix_,params_,modifVector);
+			}
+		}
+
+	private:
+
+		const InternalProductDefaultType& matrix_;
+		const ParametersForSolverType& params_;
+		const PsimagLite::Vector<PairType>::Type& sitePairs_;
+		const VectorVectorType& first_;
+		const VectorVectorType& second_;
+		SizeType parity_;
+		bool onlyFirstIfSameSite_;
+		bool sameOrbital_;
+		SpectralChains& chains_;
+	}; // class PairTasks
+
+	// One task per site, fills its column of a panel with O_site|gs>
+	class PanelTasks {
+
+	public:
+
+		PanelTasks(const Engine& engine,
+		           MatrixType& panel,
+		           SizeType operatorLabel,
+		           const BasisType& basisNew,
+		           const PsimagLite::Vector<SizeType>::Type& sites,
+		           SizeType offset,
+		           SizeType spin,
+		           SizeType orb)
+		    : engine_(engine),
+		      panel_(panel),
+		      operatorLabel_(operatorLabel),
+		      basisNew_(basisNew),
+		      sites_(sites),
+		      offset_(offset),
+		      spin_(spin),
+		      orb_(orb)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			for (SizeType p = 0; p < blockSize; ++p) {
+				SizeType c = threadNum*blockSize + p;
+				if (c >= total) break;
+				VectorType modifVector(basisNew_.size(),0);
+				engine_.accModifiedState(modifVector,
+				                         operatorLabel_,
+				                         basisNew_,
+				                         engine_.gsVector_,
+				                         sites_[offset_ + c],
+				                         spin_,
+				                         orb_,
+				                         1.0,
+				                         1,
+				                         true);
+				for (SizeType k = 0; k < modifVector.size(); ++k)
+					panel_(k,c) = modifVector[k];
+			}
+		}
+
+	private:
+
+		const Engine& engine_;
+		MatrixType& panel_;
+		SizeType operatorLabel_;
+		const BasisType& basisNew_;
+		const PsimagLite::Vector<SizeType>::Type& sites_;
+		SizeType offset_;
+		SizeType spin_;
+		SizeType orb_;
+	}; // class PanelTasks
+
+	void fillPanel(MatrixType& panel,
+	               SizeType operatorLabel,
+	               const BasisType& basisNew,
+	               const PsimagLite::Vector<SizeType>::Type& sites,
+	               SizeType offset,
+	               SizeType spin,
+	               SizeType orb) const
+	{
+		typedef PsimagLite::Parallelizer<PanelTasks> ParallelizerType;
+
+		for (SizeType c = 0; c < panel.n_col(); ++c)
+			prepareModifiedState(operatorLabel,basisNew,sites[offset + c],spin,orb);
+
+		PanelTasks tasks(*this,panel,operatorLabel,basisNew,sites,offset,spin,orb);
+		ParallelizerType threaded(PsimagLite::Concurrency::npthreads,
+		                          PsimagLite::MPI::COMM_WORLD);
+		threaded.loopCreate(panel.n_col(),tasks);
+	}
+
+	static SizeType fourierParts(RealType) { return 2; }
+
+	static SizeType fourierParts(std::complex<RealType>) { return 1; }
+
+	static void fourierFactor(RealType& factor, RealType qr, SizeType part)
+	{
+		factor = (part == 0) ? cos(qr) : sin(qr);
+	}
+
+	static void fourierFactor(std::complex<RealType>& factor, RealType qr, SizeType)
+	{
+		factor = std::complex<RealType>(cos(qr),sin(qr));
+	}
+
+	void spectralSigns(int& s,
+	                   RealType& s2,
+	                   SizeType what2,
+	                   SizeType type,
+	                   bool isDiagonal) const
+	{
+		s = (type&1) ? -1 : 1;
+		s2 = (type>1) ? -1 : 1;
+		if (!ProgramGlobals::isFermionic(what2)) s2 *= s;
+		RealType diagonalFactor = (isDiagonal) ? 1 : 0.5;
+		s2 *= diagonalFactor;
+	}
+
+	// inTask is true when called from within a task; then threads is 1, and
+	// the operator must have been built by prepareModifiedState, because
+	// the cache is only read there
 	void accModifiedState_(VectorType &z,
 	                       SizeType operatorLabel,
 	                       const BasisType& newBasis,
@@ -260,40 +811,54 @@ private:
 	                       SizeType site,
 	                       SizeType spin,
 	                       SizeType orb,
-	                       RealType isign) const
+	                       const ComplexOrRealType& factor,
+	                       SizeType threads,
+	                       bool inTask = false) const
 	{
-		for (SizeType ispace=0;ispace<model_.basis().size();ispace++) {
-			ProgramGlobals::WordType ket1 = model_.basis()(ispace,SPIN_UP);
-			ProgramGlobals::WordType ket2 = model_.basis()(ispace,SPIN_DOWN);
-			ProgramGlobals::PairIntType tempValue = newBasis.getBraIndex(ket1,
-			                                                             ket2,
-			                                                             operatorLabel,
-			                                                             site,
-			                                                             spin,
-			                                                             orb);
-			int temp = tempValue.first;
-			int value = tempValue.second;
-			if (temp>=0 && SizeType(temp)>=z.size()) {
-				PsimagLite::String s = "old basis=" + ttos(model_.basis().size());
-				s += " newbasis=" + ttos(newBasis.size());
-				s += "\n";
-				s += "operatorLabel=" + ttos(operatorLabel) + " spin=" + ttos(spin);
-				s += " site=" + ttos(site);
-				s += "ket1=" + ttos(ket1) + " and ket2=" + ttos(ket2);
-				s += "\n";
-				s += "getModifiedState: z.size=" + ttos(z.size());
-				s += " but temp=" + ttos(temp) + "\n";
-				throw std::runtime_error(s.c_str());
-			}
-			if (temp<0) continue;
-			int mysign = (ProgramGlobals::isFermionic(operatorLabel)) ?
-			            model_.basis().doSignGf(ket1,ket2,site,spin,orb) : 1;
-			if (operatorLabel == ProgramGlobals::OPERATOR_SPLUS ||
-			        operatorLabel == ProgramGlobals::OPERATOR_SMINUS)
-				mysign *= model_.basis().doSignSpSm(ket1,ket2,site,spin,orb);
-
-			z[temp] += isign*mysign*value*gsVector[ispace];
+		OperatorCacheType& cache = model_.operatorCache();
+		const OperatorIndexType& op = (inTask) ?
+		            cache.find(operatorLabel,site,spin,orb,newBasis) :
+		            cache(operatorLabel,site,spin,orb,newBasis,threads);
+		if (op.source.size() != z.size()) {
+			PsimagLite::String str(__FILE__);
+			str += " " + ttos(__LINE__) + "\n";
+			str += "accModifiedState_: z.size=" + ttos(z.size());
+			str += " but newbasis=" + ttos(op.source.size()) + "\n";
+			throw std::runtime_error(str.c_str());
+		}
+
+		OperatorCacheType::apply(z,op,gsVector,factor,threads);
+	}
+
+	//! Builds what accModifiedState needs, before it is called from tasks
+	void prepareModifiedState(SizeType operatorLabel,
+	                          const BasisType& newBasis,
+	                          SizeType site,
+	                          SizeType spin,
+	                          SizeType orb) const
+	{
+		OperatorCacheType& cache = model_.operatorCache();
+		SizeType threads = PsimagLite::Concurrency::npthreads;
+		if (operatorLabel==ProgramGlobals::OPERATOR_SZ) {
+			cache(OPERATOR_N,site,SPIN_UP,orb,newBasis,threads);
+			cache(OPERATOR_N,site,SPIN_DOWN,orb,newBasis,threads);
+			return;
 		}
+
+		cache(operatorLabel,site,spin,orb,newBasis,threads);
+	}
+
+	void cacheModifiedState(typename PsimagLite::Vector<VectorType>::Type& cache,
+	                        SizeType operatorLabel,
+	                        const BasisType& basisNew,
+	                        SizeType site,
+	                        SizeType spin,
+	                        SizeType orb) const
+	{
+		if (cache[site].size() > 0) return;
+		cache[site].resize(basisNew.size(),0);
+		accModifiedState_(cache[site],operatorLabel,basisNew,gsVector_,site,spin,orb,1.0,
+		                  PsimagLite::Concurrency::npthreads);
 	}
 
 	void getModifiedState(VectorType& modifVector,
@@ -317,7 +882,8 @@ private:
 		                  isite,
 		                  spin,
 		                  orbs.first,
-		                  1.0);
+		                  1.0,
+		                  PsimagLite::Concurrency::npthreads);
 		std::cerr<<"isite="<<isite<<" type="<<type;
 		std::cerr<<" modif="<<(modifVector*modifVector)<<"\n";
 		if (model_.name()=="Tj1Orb.h" && isite==jsite) return;
@@ -330,7 +896,8 @@ private:
 		                  jsite,
 		                  spin,
 		                  orbs.second,
-		                  isign);
+		                  isign,
+		                  PsimagLite::Concurrency::npthreads);
 		std::cerr<<"jsite="<<jsite<<" type="<<type;
 		std::cerr<<" modif="<<(modifVector*modifVector)<<"\n";
 	}
@@ -342,49 +909,114 @@ private:
 	                      SizeType site,
 	                      SizeType spin,
 	                      SizeType orb,
-	                      RealType isign) const
+	                      const ComplexOrRealType& factor,
+	                      SizeType threads,
+	                      bool inTask = false) const
 	{
 		if (model_.name()=="Tj1Orb.h")
-			accModifiedState_(z,operatorLabel,newBasis,gsVector,site,spin,orb,isign);
+			accModifiedState_(z,operatorLabel,newBasis,gsVector,site,spin,orb,factor,threads,
+			                  inTask);
 
 		if (operatorLabel==OPERATOR_N) {
-			accModifiedState_(z,operatorLabel,newBasis,gsVector,site,spin,orb,isign);
+			accModifiedState_(z,operatorLabel,newBasis,gsVector,site,spin,orb,factor,threads,
+			                  inTask);
 			return;
 		} else if (operatorLabel==ProgramGlobals::OPERATOR_SZ) {
-			accModifiedState_(z,OPERATOR_N,newBasis,gsVector,site,SPIN_UP,orb,isign*0.5);
-			accModifiedState_(z,OPERATOR_N,newBasis,gsVector,site,SPIN_DOWN,orb,-isign*0.5);
+			accModifiedState_(z,OPERATOR_N,newBasis,gsVector,site,SPIN_UP,orb,factor*0.5,
+			                  threads,inTask);
+			accModifiedState_(z,OPERATOR_N,newBasis,gsVector,site,SPIN_DOWN,orb,-factor*0.5,
+			                  threads,inTask);
 			return;
 		}
 
-		accModifiedState_(z,operatorLabel,newBasis,gsVector,site,spin,orb,isign);
+		accModifiedState_(z,operatorLabel,newBasis,gsVector,site,spin,orb,factor,threads,inTask);
 	}
 
 	void computeGroundState()
 	{
+		typedef GroundStateFile<ComplexOrRealType> GroundStateFileType;
+		typedef LanczosCheckpoint<ComplexOrRealType> LanczosCheckpointType;
+
+		SizeType sector = 0;
+		if (gsFile_.enabled() && !gsFile_.recompute &&
+		        GroundStateFileType::read(gsEnergy_,
+		                                  gsVector_,
+		                                  sector,
+		                                  gsFile_,
+		                                  model_.basis().size())) {
+			std::cout<<"#GroundStateFile: read "<<gsFile_.filename;
+			std::cout<<" sector="<<sector<<"\n";
+			return;
+		}
+
 		SpecialSymmetryType rs(model_.basis(),model_.geometry(),options_);
+		rs.setDumpOptions(DumpOptions<RealType>(io_));
 		InternalProductType hamiltonian(model_,rs);
 		ParametersForSolverType params(io_,"Lanczos");
 		LanczosSolverType lanczosSolver(hamiltonian,params);
+		bool thickRestart = (options_.find("ThickRestartLanczos") != PsimagLite::String::npos);
+		typename ThickRestartLanczosType::ParamsType thickRestartParams(io_);
+		bool blockDavidson = (options_.find("BlockDavidson") != PsimagLite::String::npos);
+		typename BlockDavidsonType::ParamsType davidsonParams(io_);
+		LanczosCheckpointType checkpoint(io_,options_,gsFile_.inputFile);
+		if (checkpoint.enabled() && (blockDavidson || thickRestart)) {
+			PsimagLite::String str(__FILE__);
+			str += " " + ttos(__LINE__) + "\n";
+			str += "LanczosCheckpoint= cannot be used with ThickRestartLanczos ";
+			str += "or BlockDavidson\n";
+			throw PsimagLite::RuntimeError(str);
+		}
 
 		gsEnergy_ = 1e10;
 		SizeType offset = model_.size();
 		SizeType currentOffset = 0;
-		for (SizeType i=0;i<rs.sectors();i++) {
+		SizeType firstSector = 0;
+		if (checkpoint.load()) {
+			firstSector = checkpoint.sector();
+			currentOffset = checkpoint.currentOffset();
+			if (checkpoint.best().size() > 0) {
+				gsVector_ = checkpoint.best();
+				gsEnergy_ = checkpoint.bestEnergy();
+				offset = checkpoint.bestOffset();
+				sector = checkpoint.bestSector();
+			}
+		}
+
+		for (SizeType i=firstSector;i<rs.sectors();i++) {
 			hamiltonian.specialSymmetrySector(i);
 			VectorType gsVector1(hamiltonian.rank());
 			if (gsVector1.size()==0) continue;
 			RealType gsEnergy1 = 0;
 
+			checkpoint.setSector(i,currentOffset,sector,offset,gsEnergy_,gsVector_);
+			if (i > firstSector) checkpoint.saveSector();
+
 			try {
-				lanczosSolver.computeGroundState(gsEnergy1,gsVector1);
+				if (blockDavidson) {
+					BlockDavidsonType davidson(hamiltonian,davidsonParams);
+					davidson.computeGroundState(gsEnergy1,gsVector1);
+				} else if (thickRestart) {
+					ThickRestartLanczosType thickRestartLanczos(hamiltonian,thickRestartParams);
+					thickRestartLanczos.computeGroundState(gsEnergy1,gsVector1);
+				} else if (fused_ || twoPass_ || checkpoint.enabled()) {
+					FusedLanczosType fusedLanczos(hamiltonian,
+					                              params.steps,
+					                              params.tolerance,
+					                              PsimagLite::Concurrency::npthreads,
+					                              twoPass_ || checkpoint.enabled());
+					if (checkpoint.enabled()) fusedLanczos.setCheckpoint(&checkpoint);
+					fusedLanczos.computeGroundState(gsEnergy1,gsVector1);
+				} else {
+					lanczosSolver.computeGroundState(gsEnergy1,gsVector1);
+				}
 			} catch (std::exception& e) {
 
 				std::cerr<<"Engine: Lanczos Solver failed ";
-				std::cerr<<" trying exact diagonalization...\n";
-				VectorRealType eigs(hamiltonian.rank());
+				std::cerr<<" trying exact diagonalization of the lowest state...\n";
+				VectorRealType eigs;
 				MatrixType fm;
-				hamiltonian.fullDiag(eigs,fm);
-				for (SizeType j = 0; j < eigs.size(); ++j)
+				hamiltonian.lowestDense(eigs,fm,1);
+				for (SizeType j = 0; j < gsVector1.size(); ++j)
 					gsVector1[j] = fm(j,0);
 				gsEnergy1 = eigs[0];
 				std::cout<<"Found lowest eigenvalue= "<<gsEnergy1<<"\n";
@@ -394,11 +1026,17 @@ private:
 				gsVector_=gsVector1;
 				gsEnergy_=gsEnergy1;
 				offset = currentOffset;
+				sector = i;
 			}
 			currentOffset +=  gsVector1.size();
 		}
 		rs.transformGs(gsVector_,offset);
 		std::cout<<"#GSNorm="<<PsimagLite::real(gsVector_*gsVector_)<<"\n";
+		checkpoint.remove();
+
+		if (!gsFile_.enabled()) return;
+		GroundStateFileType::write(gsFile_,gsEnergy_,gsVector_,sector,offset);
+		std::cout<<"#GroundStateFile: wrote "<<gsFile_.filename<<"\n";
 	}
 
 	template<typename ContinuedFractionType>
@@ -407,30 +1045,38 @@ private:
 	                  const VectorType& modifVector,
 	                  const InternalProductDefaultType& matrix,
 	                  SizeType type,
-	                  SizeType,
-	                  bool isDiagonal) const
+	                  const PairType& orbs,
+	                  bool isDiagonal,
+	                  SpectralGridType* grid) const
 	{
 		typedef typename ContinuedFractionType::TridiagonalMatrixType
 		        TridiagonalMatrixType;
 
 		ParametersForSolverType params(io_,"Spectral");
 
-		LanczosSolverDefaultType lanczosSolver(matrix,params);
-
 		TridiagonalMatrixType ab;
+		MatrixRealType reortho;
 
-		lanczosSolver.decomposition(modifVector,ab);
-		typename VectorType::value_type weight = modifVector*modifVector;
+		if (fused_) {
+			FusedLanczosDefaultType fusedLanczos(matrix,
+			                                     params.steps,
+			                                     params.tolerance,
+			                                     PsimagLite::Concurrency::npthreads);
+			fusedLanczos.decomposition(modifVector,ab);
+		} else {
+			LanczosSolverDefaultType lanczosSolver(matrix,params);
+			lanczosSolver.decomposition(modifVector,ab);
+			reortho = lanczosSolver.reorthogonalizationMatrix();
+		}
 
-		int s = (type&1) ? -1 : 1;
-		RealType s2 = (type>1) ? -1 : 1;
-		if (!ProgramGlobals::isFermionic(what2)) s2 *= s;
-		RealType diagonalFactor = (isDiagonal) ? 1 : 0.5;
-		s2 *= diagonalFactor;
+		typename VectorType::value_type weight = modifVector*modifVector;
 
-		const MatrixRealType& reortho = lanczosSolver.reorthogonalizationMatrix();
+		int s = 1;
+		RealType s2 = 1;
+		spectralSigns(s,s2,what2,type,isDiagonal);
 
 		cf.set(ab,reortho,gsEnergy_,PsimagLite::real(weight*s2),s);
+		if (grid) grid->push(ab,gsEnergy_,PsimagLite::real(weight*s2),s,orbs);
 
 	}
 
@@ -438,6 +1084,9 @@ private:
 	PsimagLite::ProgressIndicator progress_;
 	InputType& io_;
 	PsimagLite::String options_;
+	bool fused_;
+	bool twoPass_;
+	GroundStateFileParams gsFile_;
 	RealType gsEnergy_;
 	VectorType gsVector_;
 }; // class ContinuedFraction
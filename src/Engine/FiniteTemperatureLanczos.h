@@ -0,0 +1,387 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file FiniteTemperatureLanczos.h
+ *
+ *  Finite-temperature Lanczos method (FTLM):
+ *  For each (nup,ndown) sector s of dimension D_s, and R random vectors |r>,
+ *  a Lanczos chain of M steps gives Ritz pairs (e_j,|psi_j>), and
+ *  Z = sum_s (D_s/R) sum_{r,j} exp(-beta(e_j-mu N_s))|<r|psi_j>|^2
+ *  <A> = sum_s (D_s/R) sum_{r,j} exp(-beta(e_j-mu N_s))<r|psi_j><psi_j|A|r>/Z
+ *  Only the Ritz data is kept, so any beta and mu can be evaluated afterwards.
+ *
+ */
+#ifndef LANCZOS_FINITE_TEMPERATURE_LANCZOS_H
+#define LANCZOS_FINITE_TEMPERATURE_LANCZOS_H
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include "Vector.h"
+#include "Matrix.h"
+#include "Random48.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+#include "ProgressIndicator.h"
+#include "ProgramGlobals.h"
+#include "DefaultSymmetry.h"
+#include "TypeToString.h"
+
+namespace LanczosPlusPlus {
+
+template<typename RealType>
+struct FtlmParams {
+
+	FtlmParams()
+	    : samples(10),steps(100),seed(1234),operatorName(""),site(0)
+	{}
+
+	SizeType samples;
+	SizeType steps;
+	long int seed;
+	PsimagLite::String operatorName;
+	SizeType site;
+}; // struct FtlmParams
+
+// Ritz data of one random vector in one sector
+template<typename RealType>
+struct FtlmSample {
+
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	VectorRealType eigs;
+	VectorRealType weights;
+	PsimagLite::Matrix<RealType> observables; // Ritz index x site
+}; // struct FtlmSample
+
+template<typename ModelType, typename InternalProductType>
+class FtlmSampling {
+
+	typedef typename ModelType::RealType RealType;
+	typedef typename ModelType::ComplexOrRealType ComplexOrRealType;
+	typedef typename ModelType::BasisBaseType BasisType;
+	typedef typename BasisType::WordType WordType;
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Matrix<RealType> MatrixRealType;
+	typedef PsimagLite::Random48<RealType> RandomType;
+	typedef FtlmParams<RealType> FtlmParamsType;
+	typedef FtlmSample<RealType> FtlmSampleType;
+
+public:
+
+	typedef typename PsimagLite::Vector<FtlmSampleType>::Type VectorFtlmSampleType;
+
+	FtlmSampling(VectorFtlmSampleType& results,
+	             const ModelType& model,
+	             const BasisType& basis,
+	             const InternalProductType& matrix,
+	             const FtlmParamsType& params,
+	             SizeType sectorIndex)
+	    : results_(results),
+	      model_(model),
+	      basis_(basis),
+	      matrix_(matrix),
+	      params_(params),
+	      sectorIndex_(sectorIndex)
+	{
+		// the observables depend only on the basis state, not on the sample
+		SizeType nsites = (params_.operatorName == "") ? 0 :
+		                                                 model_.geometry().numberOfSites();
+		if (nsites == 0) return;
+
+		SizeType n = basis_.size();
+		observables_.resize(n,nsites);
+		VectorRealType a(nsites);
+		for (SizeType x = 0; x < n; ++x) {
+			diagonalObservables(a,model_,basis_,x,params_.operatorName,params_.site);
+			for (SizeType site = 0; site < nsites; ++site)
+				observables_(x,site) = a[site];
+		}
+	}
+
+	void thread_function_(SizeType threadNum,
+	                      SizeType blockSize,
+	                      SizeType total,
+	                      PsimagLite::Concurrency::MutexType*)
+	{
+		for (SizeType p = 0; p < blockSize; ++p) {
+			SizeType taskNumber = threadNum*blockSize + p;
+			if (taskNumber >= total) break;
+			doTask(results_[taskNumber],taskNumber);
+		}
+	}
+
+	// Applies the diagonal observables to basis state ispace
+	static void diagonalObservables(VectorRealType& a,
+	                                const ModelType& model,
+	                                const BasisType& basis,
+	                                SizeType ispace,
+	                                const PsimagLite::String& operatorName,
+	                                SizeType site0)
+	{
+		SizeType nsites = a.size();
+		if (nsites == 0) return;
+
+		WordType ket1 = basis(ispace,ProgramGlobals::SPIN_UP);
+		WordType ket2 = basis(ispace,ProgramGlobals::SPIN_DOWN);
+		bool isSz = (operatorName == "sz");
+		for (SizeType site = 0; site < nsites; ++site) {
+			RealType nup = 0;
+			RealType ndown = 0;
+			for (SizeType orb = 0; orb < model.orbitals(site); ++orb) {
+				nup += basis.getN(ket1,ket2,site,ProgramGlobals::SPIN_UP,orb);
+				ndown += basis.getN(ket1,ket2,site,ProgramGlobals::SPIN_DOWN,orb);
+			}
+
+			a[site] = (isSz) ? 0.5*(nup - ndown) : nup + ndown;
+		}
+
+		RealType value = a[site0];
+		for (SizeType site = 0; site < nsites; ++site)
+			a[site] *= value;
+	}
+
+private:
+
+	void doTask(FtlmSampleType& sample, SizeType sampleIndex) const
+	{
+		SizeType n = basis_.size();
+		SizeType nsites = (params_.operatorName == "") ? 0 :
+		                                                 model_.geometry().numberOfSites();
+
+		RandomType rng(params_.seed + sectorIndex_*params_.samples + sampleIndex);
+		VectorType r(n);
+		RealType oneOverSqrtN = 1.0/sqrt(static_cast<RealType>(n));
+		for (SizeType i = 0; i < n; ++i)
+			r[i] = (rng() < 0.5) ? -oneOverSqrtN : oneOverSqrtN;
+
+		VectorType vPrev(n,0);
+		VectorType v = r;
+		VectorType w(n);
+		VectorRealType alpha;
+		VectorRealType beta;
+		typename PsimagLite::Vector<VectorRealType>::Type overlaps;
+		RealType betaPrev = 0;
+
+		for (SizeType k = 0; k < params_.steps; ++k) {
+			// <v_k|A|r> for the diagonal observables
+			VectorRealType o(nsites,0);
+			for (SizeType x = 0; x < n && nsites > 0; ++x) {
+				ComplexOrRealType c = PsimagLite::conj(v[x])*r[x];
+				if (c == static_cast<RealType>(0)) continue;
+				for (SizeType site = 0; site < nsites; ++site)
+					o[site] += PsimagLite::real(c)*observables_(x,site);
+			}
+
+			overlaps.push_back(o);
+
+			std::fill(w.begin(),w.end(),ComplexOrRealType(0));
+			matrix_.matrixVectorProduct(w,v);
+			ComplexOrRealType tmp = 0;
+			for (SizeType i = 0; i < n; ++i)
+				tmp += PsimagLite::conj(v[i])*w[i];
+			RealType alphaK = PsimagLite::real(tmp);
+			alpha.push_back(alphaK);
+
+			RealType b = 0;
+			for (SizeType i = 0; i < n; ++i) {
+				w[i] -= alphaK*v[i] + betaPrev*vPrev[i];
+				b += PsimagLite::real(PsimagLite::conj(w[i])*w[i]);
+			}
+
+			b = sqrt(b);
+			if (k + 1 == params_.steps || b < 1e-10) break;
+
+			beta.push_back(b);
+			vPrev.swap(v);
+			for (SizeType i = 0; i < n; ++i)
+				v[i] = w[i]/b;
+			betaPrev = b;
+		}
+
+		SizeType m = alpha.size();
+		MatrixRealType t(m,m);
+		for (SizeType i = 0; i < m; ++i) {
+			t(i,i) = alpha[i];
+			if (i + 1 < m) t(i,i+1) = t(i+1,i) = beta[i];
+		}
+
+		sample.eigs.resize(m);
+		diag(t,sample.eigs,'V');
+
+		sample.weights.resize(m);
+		sample.observables.resize(m,nsites);
+		for (SizeType j = 0; j < m; ++j) {
+			sample.weights[j] = t(0,j)*t(0,j);
+			for (SizeType site = 0; site < nsites; ++site) {
+				RealType sum = 0;
+				for (SizeType k = 0; k < m; ++k)
+					sum += t(k,j)*overlaps[k][site];
+				sample.observables(j,site) = t(0,j)*sum;
+			}
+		}
+	}
+
+	VectorFtlmSampleType& results_;
+	const ModelType& model_;
+	const BasisType& basis_;
+	const InternalProductType& matrix_;
+	const FtlmParamsType& params_;
+	SizeType sectorIndex_;
+	MatrixRealType observables_; // basis state x site
+}; // class FtlmSampling
+
+template<typename ModelType,
+         template<typename,typename> class InternalProductTemplate>
+class FiniteTemperatureLanczos {
+
+	typedef typename ModelType::RealType RealType;
+	typedef typename ModelType::BasisBaseType BasisType;
+	typedef typename ModelType::GeometryType GeometryType;
+	typedef DefaultSymmetry<GeometryType,BasisType> DefaultSymmetryType;
+	typedef InternalProductTemplate<ModelType,DefaultSymmetryType> InternalProductType;
+	typedef FtlmSampling<ModelType,InternalProductType> FtlmSamplingType;
+	typedef typename FtlmSamplingType::VectorFtlmSampleType VectorFtlmSampleType;
+	typedef typename PsimagLite::Vector<VectorFtlmSampleType>::Type VectorVectorFtlmSampleType;
+	typedef PsimagLite::Parallelizer<FtlmSamplingType> ParallelizerType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+public:
+
+	typedef FtlmParams<RealType> FtlmParamsType;
+
+	FiniteTemperatureLanczos(const ModelType& model, const FtlmParamsType& params)
+	    : model_(model),params_(params),progress_("FiniteTemperatureLanczos")
+	{
+		if (params_.operatorName != "" &&
+		        params_.operatorName != "n" &&
+		        params_.operatorName != "sz") {
+			PsimagLite::String str(__FILE__);
+			str += " " + ttos(__LINE__) + "\n";
+			str += "FTLM: unsupported operator " + params_.operatorName + "\n";
+			throw PsimagLite::RuntimeError(str);
+		}
+
+		if (params_.site >= model_.geometry().numberOfSites())
+			throw PsimagLite::RuntimeError("FTLM: site too big\n");
+	}
+
+	// The basis is deleted here, so that only one sector is in memory
+	void addSector(SizeType nup, SizeType ndown)
+	{
+		const BasisType* basis = model_.createBasis(nup,ndown);
+		if (basis->size() > 0) sampleSector(*basis,nup,ndown);
+		delete basis;
+	}
+
+	void print(std::ostream& os,
+	           const VectorRealType& betas,
+	           const VectorRealType& mus) const
+	{
+		SizeType nsites = (params_.operatorName == "") ? 0 :
+		                                                 model_.geometry().numberOfSites();
+		os<<"#beta mu lnZ energy density";
+		if (nsites > 0) {
+			os<<" <"<<params_.operatorName<<"_"<<params_.site<<" "<<params_.operatorName;
+			os<<"_j> for j=0.."<<(nsites - 1);
+		}
+
+		os<<"\n";
+
+		for (SizeType i = 0; i < betas.size(); ++i)
+			for (SizeType j = 0; j < mus.size(); ++j)
+				printOne(os,betas[i],mus[j],nsites);
+	}
+
+private:
+
+	void sampleSector(const BasisType& basis, SizeType nup, SizeType ndown)
+	{
+		DefaultSymmetryType symm(basis,model_.geometry(),"");
+		InternalProductType matrix(model_,basis,symm);
+
+		samples_.push_back(VectorFtlmSampleType(params_.samples));
+		particles_.push_back(nup + ndown);
+		dimensions_.push_back(basis.size());
+
+		FtlmSamplingType helper(samples_.back(),
+		                        model_,
+		                        basis,
+		                        matrix,
+		                        params_,
+		                        samples_.size() - 1);
+		ParallelizerType threaded(PsimagLite::Concurrency::npthreads,
+		                          PsimagLite::MPI::COMM_WORLD);
+		threaded.loopCreate(params_.samples,helper);
+
+		PsimagLite::OstringStream msg;
+		msg<<"Sector nup="<<nup<<" ndown="<<ndown<<" size="<<basis.size();
+		msg<<" sampled "<<params_.samples<<" times";
+		progress_.printline(msg,std::cerr);
+	}
+
+	void printOne(std::ostream& os, RealType beta, RealType mu, SizeType nsites) const
+	{
+		// shift exponents by their maximum so that exp cannot overflow
+		RealType shift = -1e300;
+		for (SizeType s = 0; s < samples_.size(); ++s)
+			for (SizeType r = 0; r < samples_[s].size(); ++r)
+				for (SizeType j = 0; j < samples_[s][r].eigs.size(); ++j)
+					shift = std::max(shift,exponent(s,r,j,beta,mu));
+
+		RealType z = 0;
+		RealType energy = 0;
+		RealType density = 0;
+		VectorRealType observables(nsites,0);
+		for (SizeType s = 0; s < samples_.size(); ++s) {
+			RealType factor = static_cast<RealType>(dimensions_[s])/params_.samples;
+			for (SizeType r = 0; r < samples_[s].size(); ++r) {
+				const FtlmSample<RealType>& sample = samples_[s][r];
+				for (SizeType j = 0; j < sample.eigs.size(); ++j) {
+					RealType boltzmann = factor*exp(exponent(s,r,j,beta,mu) - shift);
+					RealType tmp = boltzmann*sample.weights[j];
+					z += tmp;
+					energy += tmp*sample.eigs[j];
+					density += tmp*particles_[s];
+					for (SizeType site = 0; site < nsites; ++site)
+						observables[site] += boltzmann*sample.observables(j,site);
+				}
+			}
+		}
+
+		os<<beta<<" "<<mu<<" "<<(log(z) + shift)<<" "<<(energy/z)<<" "<<(density/z);
+		for (SizeType site = 0; site < nsites; ++site)
+			os<<" "<<(observables[site]/z);
+		os<<"\n";
+	}
+
+	RealType exponent(SizeType s, SizeType r, SizeType j, RealType beta, RealType mu) const
+	{
+		return -beta*(samples_[s][r].eigs[j] - mu*particles_[s]);
+	}
+
+	const ModelType& model_;
+	const FtlmParamsType& params_;
+	PsimagLite::ProgressIndicator progress_;
+	VectorVectorFtlmSampleType samples_;
+	PsimagLite::Vector<SizeType>::Type particles_;
+	PsimagLite::Vector<SizeType>::Type dimensions_;
+}; // class FiniteTemperatureLanczos
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_FINITE_TEMPERATURE_LANCZOS_H
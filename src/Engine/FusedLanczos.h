@@ -0,0 +1,377 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file FusedLanczos.h
+ *
+ *  Lanczos with two sweeps per step. The sweep of H computes
+ *  w = H v_j - beta_{j-1} v_{j-1} and alpha_j = <v_j|w> (fusedProduct of
+ *  the internal product), and one sweep over vectors computes
+ *  w -= alpha_j v_j and |w|^2. Vectors are not normalized; each has a
+ *  scale instead, which the next sweep of H applies.
+ *
+ *  The ground state keeps all Lanczos vectors, or, in two-pass mode, only
+ *  three: the first pass finds T and its lowest eigenvector, and the
+ *  second one runs the same chain again from the same seed and adds
+ *  the Lanczos vectors into the eigenvector. Only the two-pass mode can
+ *  be checkpointed, because its state is three vectors and alpha and beta.
+ *
+ */
+#ifndef LANCZOS_FUSED_LANCZOS_H
+#define LANCZOS_FUSED_LANCZOS_H
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include "Vector.h"
+#include "Matrix.h"
+#include "Random48.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+#include "TypeToString.h"
+#include "LanczosCheckpoint.h"
+
+namespace LanczosPlusPlus {
+
+template<typename MatrixType, typename ComplexOrRealType>
+class FusedLanczos {
+
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+	typedef typename PsimagLite::Vector<VectorType>::Type VectorVectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Matrix<RealType> MatrixRealType;
+	typedef PsimagLite::Random48<RealType> RandomType;
+	typedef LanczosCheckpoint<ComplexOrRealType> CheckpointType;
+	typedef typename CheckpointType::State CheckpointStateType;
+
+	enum {SEED = 1234};
+
+	// x -= c y and |x|^2, one task per element
+	class CombineTasks {
+
+	public:
+
+		CombineTasks(VectorType& x, const VectorType& y, RealType c, SizeType threads)
+		    : x_(x),y_(y),c_(c),norms_(threads,0)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			SizeType start = threadNum*blockSize;
+			SizeType end = std::min<SizeType>(start + blockSize,total);
+			RealType sum = 0;
+			for (SizeType i = start; i < end; ++i) {
+				x_[i] -= c_*y_[i];
+				sum += PsimagLite::real(PsimagLite::conj(x_[i])*x_[i]);
+			}
+
+			norms_[threadNum] = sum;
+		}
+
+		RealType norm2() const
+		{
+			RealType sum = 0;
+			for (SizeType t = 0; t < norms_.size(); ++t)
+				sum += norms_[t];
+			return sum;
+		}
+
+	private:
+
+		VectorType& x_;
+		const VectorType& y_;
+		RealType c_;
+		VectorRealType norms_;
+	}; // class CombineTasks
+
+public:
+
+	FusedLanczos(const MatrixType& matrix,
+	             SizeType steps,
+	             RealType tolerance,
+	             SizeType threads,
+	             bool twoPass = false)
+	    : matrix_(matrix),
+	      n_(matrix.rank()),
+	      steps_(std::max<SizeType>(steps,1)),
+	      tolerance_(tolerance),
+	      threads_(threads),
+	      twoPass_(twoPass),
+	      checkpoint_(0)
+	{}
+
+	//! Two-pass mode only; the checkpoint must live until computeGroundState returns
+	void setCheckpoint(CheckpointType* checkpoint)
+	{
+		checkpoint_ = checkpoint;
+	}
+
+	//! Lowest eigenpair
+	void computeGroundState(RealType& energy, VectorType& z)
+	{
+		if (twoPass_)
+			groundStateTwoPass(energy,z);
+		else
+			groundStateStored(energy,z);
+
+		std::cout<<"FusedLanczos: energy= "<<energy;
+		std::cout<<((twoPass_) ? " in two passes\n" : "\n");
+	}
+
+	//! Tridiagonal matrix of the chain that starts at init, not reorthogonalized
+	template<typename TridiagonalMatrixType>
+	void decomposition(const VectorType& init, TridiagonalMatrixType& ab)
+	{
+		VectorType u = init;
+		VectorType p(n_,0);
+		RealType s = 1.0/sqrt(norm2(u));
+		RealType bprev = 0;
+		VectorRealType alpha;
+		VectorRealType beta;
+		SizeType maxSteps = std::min(steps_,n_);
+		for (SizeType j = 0; j < maxSteps; ++j) {
+			RealType b = 0;
+			// p holds v_{j-1} and gets the next vector
+			alpha.push_back(step(p,u,s,p,bprev,b));
+			if (b < 1e-12 || j + 1 == maxSteps) break;
+
+			beta.push_back(b);
+			u.swap(p);
+			bprev = b*s;
+			s = 1.0/b;
+		}
+
+		ab.resize(alpha.size());
+		for (SizeType j = 0; j < alpha.size(); ++j) {
+			ab.a(j) = alpha[j];
+			ab.b(j) = (j < beta.size()) ? beta[j] : 0;
+		}
+	}
+
+private:
+
+	// All Lanczos vectors are kept
+	void groundStateStored(RealType& energy, VectorType& z) const
+	{
+		VectorVectorType krylov(1,VectorType(n_));
+		initialVector(krylov[0],SEED);
+		VectorRealType scales(1,1.0/sqrt(norm2(krylov[0])));
+		VectorRealType alpha;
+		VectorRealType beta;
+		MatrixRealType t;
+		VectorRealType ritz;
+		RealType eOld = 0;
+		SizeType maxSteps = std::min(steps_,n_);
+		for (SizeType j = 0; j < maxSteps; ++j) {
+			krylov.push_back(VectorType(n_));
+			RealType b = 0;
+			const VectorType& prev = (j > 0) ? krylov[j - 1] : krylov[j];
+			RealType bprev = (j > 0) ? beta[j - 1]*scales[j - 1] : 0;
+			alpha.push_back(step(krylov[j + 1],krylov[j],scales[j],prev,bprev,b));
+
+			bool last = (b < 1e-12 || j + 1 == maxSteps);
+			if (stop(t,ritz,eOld,alpha,beta,j,last)) break;
+
+			beta.push_back(b);
+			scales.push_back(1.0/b);
+		}
+
+		energy = ritz[0];
+		z.resize(n_);
+		std::fill(z.begin(),z.end(),ComplexOrRealType(0));
+		for (SizeType k = 0; k < alpha.size(); ++k) {
+			RealType c = t(k,0)*scales[k];
+			for (SizeType i = 0; i < n_; ++i)
+				z[i] += c*krylov[k][i];
+		}
+
+		RealType nrm = sqrt(norm2(z));
+		for (SizeType i = 0; i < n_; ++i)
+			z[i] /= nrm;
+	}
+
+	// Three vectors in the first pass, and the eigenvector in the second;
+	// st is all that a checkpoint needs to resume
+	void groundStateTwoPass(RealType& energy, VectorType& z) const
+	{
+		CheckpointStateType st;
+		if (!checkpoint_ || !checkpoint_->resume(st,n_)) {
+			st.seed = SEED;
+			st.u.resize(n_);
+			st.p.resize(n_,0);
+			initialVector(st.u,st.seed);
+			st.s = 1.0/sqrt(norm2(st.u));
+		}
+
+		if (st.pass == 0) {
+			MatrixRealType t;
+			VectorRealType ritz;
+			RealType eOld = 0;
+			SizeType maxSteps = std::min(steps_,n_);
+			for (SizeType j = st.step; j < maxSteps; ++j) {
+				RealType b = 0;
+				st.alpha.push_back(step(st.p,st.u,st.s,st.p,st.bprev,b));
+				bool last = (b < 1e-12 || j + 1 == maxSteps);
+				if (stop(t,ritz,eOld,st.alpha,st.beta,j,last)) break;
+
+				st.beta.push_back(b);
+				st.u.swap(st.p);
+				st.bprev = b*st.s;
+				st.s = 1.0/b;
+				st.step = j + 1;
+				save(st);
+			}
+
+			// T is not diagonalized again on resume, where the sign of its
+			// eigenvector could differ from that of the steps already done
+			st.energy = ritz[0];
+			st.t0.resize(st.alpha.size());
+			for (SizeType j = 0; j < st.t0.size(); ++j)
+				st.t0[j] = t(j,0);
+
+			// same chain, with the betas of the first pass
+			st.pass = 1;
+			st.step = 0;
+			st.z.resize(n_);
+			std::fill(st.z.begin(),st.z.end(),ComplexOrRealType(0));
+			std::fill(st.p.begin(),st.p.end(),ComplexOrRealType(0));
+			initialVector(st.u,st.seed);
+			st.s = 1.0/sqrt(norm2(st.u));
+			st.bprev = 0;
+		}
+
+		energy = st.energy;
+
+		SizeType m = st.alpha.size();
+		assert(st.t0.size() == m);
+		for (SizeType j = st.step; j < m; ++j) {
+			RealType c = st.t0[j]*st.s;
+			for (SizeType i = 0; i < n_; ++i)
+				st.z[i] += c*st.u[i];
+
+			if (j + 1 == m) break;
+
+			RealType b = 0;
+			step(st.p,st.u,st.s,st.p,st.bprev,b);
+			st.u.swap(st.p);
+			st.bprev = st.beta[j]*st.s;
+			st.s = 1.0/st.beta[j];
+			st.step = j + 1;
+			save(st);
+		}
+
+		z.swap(st.z);
+		RealType nrm = sqrt(norm2(z));
+		for (SizeType i = 0; i < n_; ++i)
+			z[i] /= nrm;
+	}
+
+	void save(const CheckpointStateType& st) const
+	{
+		if (checkpoint_ && checkpoint_->due(st.step)) checkpoint_->save(st);
+	}
+
+	// Diagonalizes T every few steps, because that has a cost; true
+	// when the lowest Ritz value has converged or at the last step
+	bool stop(MatrixRealType& t,
+	          VectorRealType& ritz,
+	          RealType& eOld,
+	          const VectorRealType& alpha,
+	          const VectorRealType& beta,
+	          SizeType j,
+	          bool last) const
+	{
+		if (!last && (j + 1) % 4 != 0) return false;
+
+		diagonalize(t,ritz,alpha,beta);
+		bool converged = (j > 0 && fabs(ritz[0] - eOld) < tolerance_);
+		eOld = ritz[0];
+		return (last || converged);
+	}
+
+	static void initialVector(VectorType& v, SizeType seed)
+	{
+		RandomType rng(seed);
+		for (SizeType i = 0; i < v.size(); ++i)
+			v[i] = rng() - 0.5;
+	}
+
+	// x = H v - bprev v_{j-1} - alpha v with v = s u, where bprev
+	// is beta_{j-1} times the scale of prev; returns alpha and b = |x|
+	RealType step(VectorType& x,
+	              const VectorType& u,
+	              RealType s,
+	              const VectorType& prev,
+	              RealType bprev,
+	              RealType& b) const
+	{
+		ComplexOrRealType dot = matrix_.fusedProduct(x,u,prev,s,-bprev,threads_);
+		RealType alpha = s*PsimagLite::real(dot);
+
+		CombineTasks tasks(x,u,alpha*s,threads_);
+		if (threads_ > 1) {
+			PsimagLite::Parallelizer<CombineTasks> threaded(threads_,
+			                                                PsimagLite::MPI::COMM_WORLD);
+			threaded.loopCreate(n_,tasks);
+		} else {
+			tasks.thread_function_(0,n_,n_,0);
+		}
+
+		b = sqrt(tasks.norm2());
+		return alpha;
+	}
+
+	static void diagonalize(MatrixRealType& t,
+	                        VectorRealType& ritz,
+	                        const VectorRealType& alpha,
+	                        const VectorRealType& beta)
+	{
+		SizeType m = alpha.size();
+		MatrixRealType tmp(m,m);
+		for (SizeType i = 0; i < m; ++i) {
+			tmp(i,i) = alpha[i];
+			if (i + 1 < m) tmp(i,i+1) = tmp(i+1,i) = beta[i];
+		}
+
+		ritz.resize(m);
+		diag(tmp,ritz,'V');
+		t = tmp;
+	}
+
+	static RealType norm2(const VectorType& v)
+	{
+		RealType sum = 0;
+		for (SizeType i = 0; i < v.size(); ++i)
+			sum += PsimagLite::real(PsimagLite::conj(v[i])*v[i]);
+		return sum;
+	}
+
+	const MatrixType& matrix_;
+	SizeType n_;
+	SizeType steps_;
+	RealType tolerance_;
+	SizeType threads_;
+	bool twoPass_;
+	CheckpointType* checkpoint_;
+}; // class FusedLanczos
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_FUSED_LANCZOS_H
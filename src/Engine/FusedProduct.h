@@ -0,0 +1,121 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file FusedProduct.h
+ *
+ *  x = a H y + b z for a stored CRS matrix H, returning <y|x>, in one
+ *  sweep over the rows. Row i reads z[i] before it writes x[i], so x and
+ *  z may be the same vector. Each thread keeps its own partial sum.
+ *
+ */
+#ifndef LANCZOS_FUSED_PRODUCT_H
+#define LANCZOS_FUSED_PRODUCT_H
+#include <algorithm>
+#include "Vector.h"
+#include "CrsMatrix.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+
+namespace LanczosPlusPlus {
+
+template<typename SparseMatrixType, typename VectorType>
+class FusedProduct {
+
+	typedef typename VectorType::value_type ComplexOrRealType;
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+
+	// One task per row
+	class Tasks {
+
+	public:
+
+		Tasks(const SparseMatrixType& matrix,
+		      VectorType& x,
+		      const VectorType& y,
+		      const VectorType& z,
+		      RealType a,
+		      RealType b,
+		      SizeType threads)
+		    : matrix_(matrix),x_(x),y_(y),z_(z),a_(a),b_(b),dots_(threads,0)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			SizeType start = threadNum*blockSize;
+			SizeType end = std::min<SizeType>(start + blockSize,total);
+			ComplexOrRealType dot = 0;
+			for (SizeType i = start; i < end; ++i) {
+				ComplexOrRealType sum = 0;
+				for (int k = matrix_.getRowPtr(i); k < matrix_.getRowPtr(i+1); ++k)
+					sum += matrix_.getValue(k)*y_[matrix_.getCol(k)];
+
+				ComplexOrRealType xi = a_*sum + b_*z_[i];
+				x_[i] = xi;
+				dot += PsimagLite::conj(y_[i])*xi;
+			}
+
+			dots_[threadNum] = dot;
+		}
+
+		ComplexOrRealType dot() const
+		{
+			ComplexOrRealType sum = 0;
+			for (SizeType t = 0; t < dots_.size(); ++t)
+				sum += dots_[t];
+			return sum;
+		}
+
+	private:
+
+		const SparseMatrixType& matrix_;
+		VectorType& x_;
+		const VectorType& y_;
+		const VectorType& z_;
+		RealType a_;
+		RealType b_;
+		typename PsimagLite::Vector<ComplexOrRealType>::Type dots_;
+	}; // class Tasks
+
+public:
+
+	static ComplexOrRealType apply(const SparseMatrixType& matrix,
+	                               VectorType& x,
+	                               const VectorType& y,
+	                               const VectorType& z,
+	                               RealType a,
+	                               RealType b,
+	                               SizeType threads)
+	{
+		SizeType total = matrix.row();
+		Tasks tasks(matrix,x,y,z,a,b,threads);
+		if (threads > 1) {
+			PsimagLite::Parallelizer<Tasks> threaded(threads,PsimagLite::MPI::COMM_WORLD);
+			threaded.loopCreate(total,tasks);
+		} else {
+			tasks.thread_function_(0,total,total,0);
+		}
+
+		return tasks.dot();
+	}
+}; // class FusedProduct
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_FUSED_PRODUCT_H
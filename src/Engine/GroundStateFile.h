@@ -0,0 +1,246 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file GroundStateFile.h
+ *
+ *  Binary checkpoint of the ground state, so that runs that only change
+ *  -g, -c, and the like do not solve for it again.
+ *  File: Header, then the vector, in the full basis, after the symmetry
+ *  transformation. The header has the hash of the input file, and a
+ *  checkpoint with another hash, or written with another RealType or
+ *  ComplexOrRealType, or with another basis size, is ignored.
+ *  The reader memory-maps the file; the writer writes a temporary file
+ *  and renames it, so that concurrent runs never read half a checkpoint.
+ *
+ */
+#ifndef LANCZOS_GROUND_STATE_FILE_H
+#define LANCZOS_GROUND_STATE_FILE_H
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Vector.h"
+#include "TypeToString.h"
+
+namespace LanczosPlusPlus {
+
+/* PSIDOC GroundStateFile
+\begin{itemize}
+\item[GroundStateFile=] If present, the ground state is read from this file
+instead of computed, provided that the file was written for an input file
+with the same contents; otherwise the ground state is computed and written
+to this file. Use the -R command line option to compute it anyway.
+\end{itemize}
+*/
+struct GroundStateFileParams {
+
+	GroundStateFileParams() : filename(""),inputFile(""),hash(0),recompute(false)
+	{}
+
+	template<typename InputType>
+	GroundStateFileParams(InputType& io, PsimagLite::String inputFile_, bool recompute_)
+	    : filename(""),inputFile(inputFile_),hash(0),recompute(recompute_)
+	{
+		try {
+			io.readline(filename,"GroundStateFile=");
+		} catch (std::exception&) {}
+
+		if (filename != "") hash = hashFile(inputFile);
+	}
+
+	bool enabled() const { return (filename != ""); }
+
+	// FNV-1a of the contents of the input file; the word ignored, and a
+	// comma before or after it, are left out, so that adding it anywhere
+	// in a comma-separated list keeps the hash
+	static uint64_t hashFile(PsimagLite::String inputFile,
+	                         PsimagLite::String ignored = "")
+	{
+		FILE* fp = fopen(inputFile.c_str(),"rb");
+		if (!fp) {
+			PsimagLite::String str(__FILE__);
+			str += " " + ttos(__LINE__) + "\n";
+			str += "GroundStateFileParams: cannot open " + inputFile + "\n";
+			throw PsimagLite::RuntimeError(str);
+		}
+
+		PsimagLite::String contents;
+		char buffer[4096];
+		SizeType n = 0;
+		while ((n = fread(buffer,1,sizeof(buffer),fp)) > 0)
+			contents.append(buffer,n);
+		fclose(fp);
+
+		if (ignored != "") {
+			erase(contents,"," + ignored);
+			erase(contents,ignored + ",");
+			erase(contents,ignored);
+		}
+
+		uint64_t h = 14695981039346656037ULL;
+		for (SizeType i = 0; i < contents.length(); ++i) {
+			h ^= static_cast<unsigned char>(contents[i]);
+			h *= 1099511628211ULL;
+		}
+
+		return h;
+	}
+
+	static void erase(PsimagLite::String& str, PsimagLite::String word)
+	{
+		SizeType pos = 0;
+		while ((pos = str.find(word,pos)) != PsimagLite::String::npos)
+			str.erase(pos,word.length());
+	}
+
+	PsimagLite::String filename;
+	PsimagLite::String inputFile;
+	uint64_t hash;
+	bool recompute;
+}; // struct GroundStateFileParams
+
+template<typename ComplexOrRealType>
+class GroundStateFile {
+
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+
+	struct Header {
+		char magic[8];
+		uint64_t hash;
+		uint64_t realSize;
+		uint64_t elementSize;
+		uint64_t sector;
+		uint64_t offset; // of the sector, in the basis of the symmetry
+		uint64_t size;
+		double energy;
+	};
+
+	static const char* magic() { return "LPPGSTA1"; }
+
+public:
+
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+
+	//! Returns false, with a message, if there is no valid checkpoint
+	static bool read(RealType& energy,
+	                 VectorType& v,
+	                 SizeType& sector,
+	                 const GroundStateFileParams& params,
+	                 SizeType size)
+	{
+		int fd = open(params.filename.c_str(),O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat info;
+		if (fstat(fd,&info) != 0 || SizeType(info.st_size) < sizeof(Header)) {
+			::close(fd);
+			return ignored(params,"too small");
+		}
+
+		SizeType bytes = info.st_size;
+		void* ptr = mmap(0,bytes,PROT_READ,MAP_SHARED,fd,0);
+		::close(fd);
+		if (ptr == MAP_FAILED) return ignored(params,"cannot mmap");
+
+		const Header* h = static_cast<const Header*>(ptr);
+		PsimagLite::String reason("");
+		if (memcmp(h->magic,magic(),8) != 0)
+			reason = "not a ground state file";
+		else if (h->hash != params.hash)
+			reason = "the input file has changed";
+		else if (h->realSize != sizeof(RealType) || h->elementSize != sizeof(ComplexOrRealType))
+			reason = "written with a different RealType or ComplexOrRealType";
+		else if (h->size != size || bytes < sizeof(Header) + size*sizeof(ComplexOrRealType))
+			reason = "wrong size";
+
+		if (reason != "") {
+			munmap(ptr,bytes);
+			return ignored(params,reason);
+		}
+
+		energy = h->energy;
+		sector = h->sector;
+		const ComplexOrRealType* data =
+		        reinterpret_cast<const ComplexOrRealType*>(static_cast<const char*>(ptr) +
+		                                                   sizeof(Header));
+		v.resize(size);
+		for (SizeType i = 0; i < size; ++i)
+			v[i] = data[i];
+
+		munmap(ptr,bytes);
+		return true;
+	}
+
+	static void write(const GroundStateFileParams& params,
+	                  RealType energy,
+	                  const VectorType& v,
+	                  SizeType sector,
+	                  SizeType offset)
+	{
+		Header h;
+		memset(&h,0,sizeof(h));
+		memcpy(h.magic,magic(),8);
+		h.hash = params.hash;
+		h.realSize = sizeof(RealType);
+		h.elementSize = sizeof(ComplexOrRealType);
+		h.sector = sector;
+		h.offset = offset;
+		h.size = v.size();
+		h.energy = energy;
+
+		PsimagLite::String tmp = params.filename + ".tmp" + ttos(getpid());
+		FILE* fp = fopen(tmp.c_str(),"wb");
+		if (!fp) error("cannot open",tmp);
+		bool ok = (fwrite(&h,sizeof(h),1,fp) == 1);
+		if (ok && v.size() > 0)
+			ok = (fwrite(&(v[0]),sizeof(ComplexOrRealType),v.size(),fp) == v.size());
+		if (fclose(fp) != 0) ok = false;
+		if (!ok) {
+			remove(tmp.c_str());
+			error("cannot write",tmp);
+		}
+
+		if (rename(tmp.c_str(),params.filename.c_str()) != 0) {
+			remove(tmp.c_str());
+			error("cannot rename to",params.filename);
+		}
+	}
+
+private:
+
+	static bool ignored(const GroundStateFileParams& params, PsimagLite::String reason)
+	{
+		std::cerr<<"GroundStateFile: ignoring "<<params.filename<<": "<<reason<<"\n";
+		return false;
+	}
+
+	static void error(PsimagLite::String msg, PsimagLite::String filename)
+	{
+		PsimagLite::String str(__FILE__);
+		str += " " + ttos(__LINE__) + "\n";
+		str += "GroundStateFile: " + msg + " " + filename + "\n";
+		throw PsimagLite::RuntimeError(str);
+	}
+}; // class GroundStateFile
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_GROUND_STATE_FILE_H
@@ -145,6 +145,21 @@ public:
 		\item[printmatrix] Print the Hamiltonian matrix.
 		\item[dumpmatrix] Use exact diagonalization instead of Lanczos diagonalization,
 		and output all information to obtain the full spectrum.
+		\item[FusedLanczos] Use Lanczos with one sweep of the Hamiltonian and one
+		sweep of vectors per step, for the ground state and the spectral functions.
+		Vectors are not reorthogonalized.
+		\item[TwoPassLanczos] Compute the ground state with the fused Lanczos
+		iteration, keeping only three Lanczos vectors. A second pass repeats the
+		chain from the same seed to form the eigenvector, so it costs twice the
+		matrix-vector products. Spectral functions are not affected; add
+		FusedLanczos to fuse them too.
+		\item[ThickRestartLanczos] Compute the ground state with thick-restart Lanczos,
+		in bounded memory; see the ThickRestart labels below.
+		\item[BlockDavidson] Compute the lowest states with block Davidson,
+		preconditioned with the diagonal of the Hamiltonian; see the Davidson
+		labels below.
+		\item[LanczosRestart] Resume the ground state computation from the
+		file of LanczosCheckpoint=; see the LanczosCheckpoint labels below.
 		\end{itemize}
 		*/
 		registerOpts.push_back("none");
@@ -152,6 +167,11 @@ public:
 		registerOpts.push_back("InternalProductOnTheFly");
 		registerOpts.push_back("printmatrix");
 		registerOpts.push_back("dumpmatrix");
+		registerOpts.push_back("FusedLanczos");
+		registerOpts.push_back("TwoPassLanczos");
+		registerOpts.push_back("ThickRestartLanczos");
+		registerOpts.push_back("BlockDavidson");
+		registerOpts.push_back("LanczosRestart");
 
 		PsimagLite::Options::Writeable optWriteable(registerOpts,
 		                                            PsimagLite::Options::Writeable::PERMISSIVE);
@@ -115,7 +115,8 @@ public:
 		//model.setupHamiltonian(matrixStored_);
 	}
 
-	SizeType rank() const { return model_.size(); }
+	//! the size of the basis the product was built on
+	SizeType rank() const { return (basis_) ? basis_->size() : model_.size(); }
 
 	template<typename SomeVectorType>
 	void matrixVectorProduct(SomeVectorType &x,SomeVectorType const &y) const
@@ -127,6 +128,59 @@ public:
 		}
 	}
 
+	//! x = a H y + b z, returns <y|x>; x and z may be the same vector.
+	//! The product here is compute bound, so only the vector updates are fused
+	template<typename SomeVectorType>
+	typename SomeVectorType::value_type fusedProduct(SomeVectorType& x,
+	                                                 const SomeVectorType& y,
+	                                                 const SomeVectorType& z,
+	                                                 RealType a,
+	                                                 RealType b,
+	                                                 SizeType) const
+	{
+		typedef typename SomeVectorType::value_type FieldType;
+
+		assert(a != 0);
+		RealType ratio = b/a;
+		for (SizeType i = 0; i < x.size(); ++i)
+			x[i] = ratio*z[i];
+
+		matrixVectorProduct(x,y);
+
+		FieldType dot = 0;
+		for (SizeType i = 0; i < x.size(); ++i) {
+			x[i] *= a;
+			dot += PsimagLite::conj(y[i])*x[i];
+		}
+
+		return dot;
+	}
+
+	//! x += H y for a block of vectors, one column per state, one vector at a time
+	void blockProduct(MatrixType& x, const MatrixType& y) const
+	{
+		typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+
+		SizeType n = y.n_col();
+		VectorType xc(n);
+		VectorType yc(n);
+		for (SizeType c = 0; c < y.n_row(); ++c) {
+			for (SizeType i = 0; i < n; ++i) {
+				xc[i] = x(c,i);
+				yc[i] = y(c,i);
+			}
+
+			matrixVectorProduct(xc,yc);
+			for (SizeType i = 0; i < n; ++i)
+				x(c,i) = xc[i];
+		}
+	}
+
+	void diagonal(VectorRealType& d) const
+	{
+		model_.diagonal(d,(basis_) ? *basis_ : model_.basis());
+	}
+
 	SizeType reflectionSector() const { return 0; }
 
 	void specialSymmetrySector(SizeType p) {  }
@@ -136,6 +190,13 @@ public:
 		throw PsimagLite::RuntimeError("no fullDiag possible when on the fly\n");
 	}
 
+	void lowestDense(VectorRealType&,
+	                 MatrixType&,
+	                 SizeType) const
+	{
+		throw PsimagLite::RuntimeError("no lowestDense possible when on the fly\n");
+	}
+
 private:
 
 	const ModelType& model_;
@@ -121,6 +121,26 @@ public:
 		rs_.matrixVectorProduct(x,y);
 	}
 
+	//! x = a H y + b z, returns <y|x>; x and z may be the same vector
+	template<typename SomeVectorType>
+	typename SomeVectorType::value_type fusedProduct(SomeVectorType& x,
+	                                                 const SomeVectorType& y,
+	                                                 const SomeVectorType& z,
+	                                                 RealType a,
+	                                                 RealType b,
+	                                                 SizeType threads) const
+	{
+		return rs_.fusedProduct(x,y,z,a,b,threads);
+	}
+
+	//! x += H y for a block of vectors, one column per state
+	void blockProduct(MatrixType& x, const MatrixType& y) const
+	{
+		rs_.blockProduct(x,y);
+	}
+
+	void diagonal(VectorRealType& d) const { rs_.diagonal(d); }
+
 	void specialSymmetrySector(SizeType p) { rs_.setPointer(p); }
 
 	void fullDiag(VectorRealType& eigs,
@@ -129,6 +149,13 @@ public:
 		rs_.fullDiag(eigs,z);
 	}
 
+	void lowestDense(VectorRealType& eigs,
+	                 MatrixType& z,
+	                 SizeType k) const
+	{
+		rs_.lowestDense(eigs,z,k);
+	}
+
 private:
 
 	SpecialSymmetryType& rs_;
@@ -0,0 +1,276 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file KrylovEvolution.h
+ *
+ *  Short-iteration Lanczos (Krylov) propagation |psi> --> exp(-iHt)|psi>
+ *  or exp(-tH)|psi>, with adaptive time step and error control.
+ *  Only matrixVectorProduct(x,y) and rank() of the internal product are used,
+ *  so the Hamiltonian is never made dense.
+ *
+ */
+#ifndef LANCZOS_KRYLOV_EVOLUTION_H
+#define LANCZOS_KRYLOV_EVOLUTION_H
+#include <iostream>
+#include <cassert>
+#include "Vector.h"
+#include "Matrix.h"
+#include "TypeToString.h"
+
+namespace LanczosPlusPlus {
+
+template<typename InternalProductType>
+class KrylovEvolution {
+
+public:
+
+	typedef typename InternalProductType::RealType RealType;
+	typedef typename InternalProductType::ComplexOrRealType ComplexOrRealType;
+	typedef std::complex<RealType> ComplexType;
+	typedef typename PsimagLite::Vector<ComplexType>::Type VectorComplexType;
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef typename PsimagLite::Vector<VectorComplexType>::Type VectorVectorComplexType;
+	typedef PsimagLite::Matrix<RealType> MatrixRealType;
+
+	enum TimeEnum {REAL_TIME, IMAGINARY_TIME};
+
+	KrylovEvolution(const InternalProductType& matrix,
+	                SizeType maxSteps,
+	                RealType tolerance)
+	    : matrix_(matrix),
+	      maxSteps_(maxSteps),
+	      tolerance_(tolerance),
+	      dtSuggested_(0),
+	      substeps_(0),
+	      mvps_(0)
+	{
+		if (maxSteps_ < 2)
+			throw PsimagLite::RuntimeError("KrylovEvolution: maxSteps must be > 1\n");
+	}
+
+	//! Advances psi by tau; returns the sum of the error estimates of all substeps
+	RealType evolve(VectorComplexType& psi, RealType tau, TimeEnum timeType)
+	{
+		RealType t = 0;
+		RealType errorSum = 0;
+		if (dtSuggested_ <= 0) dtSuggested_ = tau;
+
+		while (tau - t > 1e-12*tau) {
+			RealType nrm = norm(psi);
+			if (nrm == 0) return errorSum;
+
+			RealType betaNext = buildKrylov(psi,nrm);
+			SizeType m = alpha_.size();
+			diagonalizeTridiagonal(m);
+
+			RealType dt = std::min(dtSuggested_,tau - t);
+			RealType err = 0;
+			while (true) {
+				computeCoefficients(dt,timeType);
+				err = nrm*betaNext*std::abs(coeffs_[m-1]);
+				if (err <= tolerance_) break;
+				dt *= 0.5;
+				if (dt < 1e-12*tau) {
+					PsimagLite::String str(__FILE__);
+					str += " " + ttos(__LINE__) + "\n";
+					str += "evolve: time step underflow, error=" + ttos(err);
+					str += ", try a larger Krylov space\n";
+					throw PsimagLite::RuntimeError(str);
+				}
+			}
+
+			for (SizeType i = 0; i < psi.size(); ++i) {
+				ComplexType sum = 0;
+				for (SizeType k = 0; k < m; ++k)
+					sum += coeffs_[k]*krylov_[k][i];
+				psi[i] = nrm*sum;
+			}
+
+			t += dt;
+			errorSum += err;
+			substeps_++;
+			dtSuggested_ = (err > 0) ? 0.9*dt*pow(tolerance_/err,1.0/m) : 2.0*dt;
+		}
+
+		return errorSum;
+	}
+
+	//! <psi|H|psi>
+	ComplexType expectationH(const VectorComplexType& psi) const
+	{
+		VectorComplexType x(psi.size(),0);
+		matrixVectorProduct(x,psi);
+		return scalarProduct(psi,x);
+	}
+
+	//! x += H y
+	void matrixVectorProduct(VectorComplexType& x, const VectorComplexType& y) const
+	{
+		mvps_++;
+		matrixVectorProduct(x,y,ComplexOrRealType());
+	}
+
+	SizeType substeps() const { return substeps_; }
+
+	SizeType mvps() const { return mvps_; }
+
+	static RealType norm(const VectorComplexType& v)
+	{
+		return sqrt(std::real(scalarProduct(v,v)));
+	}
+
+	static ComplexType scalarProduct(const VectorComplexType& v,
+	                                 const VectorComplexType& w)
+	{
+		ComplexType sum = 0;
+		for (SizeType i = 0; i < v.size(); ++i)
+			sum += std::conj(v[i])*w[i];
+		return sum;
+	}
+
+private:
+
+	// Returns the residual norm after the last Krylov step (zero on breakdown)
+	RealType buildKrylov(const VectorComplexType& psi, RealType nrm)
+	{
+		SizeType n = psi.size();
+		if (krylov_.size() != maxSteps_) krylov_.resize(maxSteps_);
+		alpha_.clear();
+		beta_.clear();
+
+		krylov_[0].resize(n);
+		for (SizeType i = 0; i < n; ++i)
+			krylov_[0][i] = psi[i]/nrm;
+
+		VectorComplexType w(n);
+		RealType betaNext = 0;
+		for (SizeType j = 0; j < maxSteps_; ++j) {
+			std::fill(w.begin(),w.end(),ComplexType(0));
+			matrixVectorProduct(w,krylov_[j]);
+			RealType a = std::real(scalarProduct(krylov_[j],w));
+			alpha_.push_back(a);
+
+			// Full reorthogonalization is affordable for a short chain
+			for (SizeType k = 0; k <= j; ++k) {
+				ComplexType overlap = scalarProduct(krylov_[k],w);
+				for (SizeType i = 0; i < n; ++i)
+					w[i] -= overlap*krylov_[k][i];
+			}
+
+			betaNext = norm(w);
+			if (betaNext < 1e-12*(1.0 + fabs(a))) return 0;
+
+			if (j + 1 == maxSteps_) break;
+
+			beta_.push_back(betaNext);
+			krylov_[j+1].resize(n);
+			for (SizeType i = 0; i < n; ++i)
+				krylov_[j+1][i] = w[i]/betaNext;
+		}
+
+		return betaNext;
+	}
+
+	void diagonalizeTridiagonal(SizeType m)
+	{
+		assert(beta_.size() + 1 == m);
+		tVectors_.resize(m,m);
+		tVectors_.setTo(0.0);
+		for (SizeType i = 0; i < m; ++i) {
+			tVectors_(i,i) = alpha_[i];
+			if (i + 1 == m) continue;
+			tVectors_(i,i+1) = tVectors_(i+1,i) = beta_[i];
+		}
+
+		tEigs_.resize(m);
+		diag(tVectors_,tEigs_,'V');
+	}
+
+	// coeffs_ = exp(z T) e_0 with z = -i dt or z = -dt
+	void computeCoefficients(RealType dt, TimeEnum timeType)
+	{
+		SizeType m = tEigs_.size();
+		ComplexType z = (timeType == REAL_TIME) ? ComplexType(0,-dt) : ComplexType(-dt,0);
+		RealType e0 = tEigs_[0];
+		coeffs_.resize(m);
+		for (SizeType k = 0; k < m; ++k) {
+			ComplexType sum = 0;
+			for (SizeType j = 0; j < m; ++j) {
+				// shift by the lowest Ritz value so that exp(-dt e) cannot overflow
+				ComplexType factor = std::exp(z*(tEigs_[j] - e0));
+				sum += tVectors_(k,j)*factor*tVectors_(0,j);
+			}
+
+			coeffs_[k] = sum;
+		}
+
+		ComplexType shift = std::exp(z*e0);
+		for (SizeType k = 0; k < m; ++k)
+			coeffs_[k] *= shift;
+	}
+
+	// Real Hamiltonian: apply it to real and imaginary parts separately
+	void matrixVectorProduct(VectorComplexType& x,
+	                         const VectorComplexType& y,
+	                         RealType) const
+	{
+		SizeType n = y.size();
+		yRe_.resize(n);
+		yIm_.resize(n);
+		xRe_.resize(n);
+		xIm_.resize(n);
+		for (SizeType i = 0; i < n; ++i) {
+			yRe_[i] = std::real(y[i]);
+			yIm_[i] = std::imag(y[i]);
+			xRe_[i] = xIm_[i] = 0;
+		}
+
+		matrix_.matrixVectorProduct(xRe_,yRe_);
+		matrix_.matrixVectorProduct(xIm_,yIm_);
+		for (SizeType i = 0; i < n; ++i)
+			x[i] += ComplexType(xRe_[i],xIm_[i]);
+	}
+
+	void matrixVectorProduct(VectorComplexType& x,
+	                         const VectorComplexType& y,
+	                         ComplexType) const
+	{
+		matrix_.matrixVectorProduct(x,y);
+	}
+
+	const InternalProductType& matrix_;
+	SizeType maxSteps_;
+	RealType tolerance_;
+	RealType dtSuggested_;
+	SizeType substeps_;
+	mutable SizeType mvps_;
+	VectorVectorComplexType krylov_;
+	VectorRealType alpha_;
+	VectorRealType beta_;
+	MatrixRealType tVectors_;
+	VectorRealType tEigs_;
+	VectorComplexType coeffs_;
+	mutable VectorType yRe_;
+	mutable VectorType yIm_;
+	mutable VectorType xRe_;
+	mutable VectorType xIm_;
+}; // class KrylovEvolution
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_KRYLOV_EVOLUTION_H
@@ -0,0 +1,446 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file LanczosCheckpoint.h
+ *
+ *  Checkpoint of the ground state computation, so that a preempted run
+ *  resumes where it was. It has the sector being solved, the best
+ *  ground state of the sectors before it, and the state of the two-pass
+ *  Lanczos in that sector: pass, step, the current and previous vectors
+ *  with their scales, alpha and beta so far, the seed, and, in the
+ *  second pass, the energy, the lowest eigenvector of T, and the
+ *  eigenvector so far. The header has the hash of the input file, if the
+ *  driver gives its name, and a checkpoint for another input is refused.
+ *  File: Header, then alpha, beta and the eigenvector of T (RealType),
+ *  then the current, previous, eigenvector and best vectors
+ *  (ComplexOrRealType).
+ *
+ *  The state is copied to a buffer, and a thread writes the buffer to
+ *  a temporary file and renames it, while Lanczos goes on. Without
+ *  USE_PTHREADS the buffer is written before Lanczos goes on.
+ *
+ */
+#ifndef LANCZOS_LANCZOS_CHECKPOINT_H
+#define LANCZOS_LANCZOS_CHECKPOINT_H
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <unistd.h>
+#ifdef USE_PTHREADS
+#include <pthread.h>
+#endif
+#include "Vector.h"
+#include "TypeToString.h"
+#include "GroundStateFile.h"
+
+namespace LanczosPlusPlus {
+
+/* PSIDOC LanczosCheckpoint
+These labels checkpoint the ground state computation, which then uses
+the Lanczos of TwoPassLanczos, whose state is small; they cannot be
+used with ThickRestartLanczos or BlockDavidson.
+\begin{itemize}
+\item[LanczosCheckpoint=] File for the checkpoint. It is written at the
+start of each sector and every LanczosCheckpointSteps= Lanczos steps,
+while Lanczos goes on, and it is removed when the ground state is done.
+\item[LanczosCheckpointSteps=] 100 by default.
+\end{itemize}
+Add LanczosRestart to SolverOptions= to resume from the checkpoint; all
+other labels must not change, and a checkpoint written for an input
+file with other contents is refused.
+*/
+template<typename ComplexOrRealType>
+class LanczosCheckpoint {
+
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Vector<char>::Type VectorCharType;
+
+	struct Header {
+		char magic[8];
+		uint64_t inputHash;
+		uint64_t realSize;
+		uint64_t elementSize;
+		uint64_t sector;
+		uint64_t currentOffset;
+		uint64_t bestSector;
+		uint64_t bestOffset;
+		double bestEnergy;
+		uint64_t hasState;
+		uint64_t pass;
+		uint64_t step;
+		uint64_t seed;
+		double s;
+		double bprev;
+		double energy;
+		uint64_t n;
+		uint64_t alphas;
+		uint64_t betas;
+		uint64_t t0Size;
+		uint64_t zSize;
+		uint64_t bestSize;
+	};
+
+	struct Job {
+
+		Job() : ok(true) {}
+
+		PsimagLite::String filename;
+		VectorCharType buffer;
+		bool ok;
+	};
+
+	static const char* magic() { return "LPPLCKP2"; }
+
+	// The token that resumes is not part of the input that is checked
+	static PsimagLite::String restartToken() { return "LanczosRestart"; }
+
+public:
+
+	//! State of the two-pass Lanczos; pass 0 finds T, pass 1 the eigenvector
+	struct State {
+
+		State() : pass(0),step(0),seed(0),s(0),bprev(0),energy(0) {}
+
+		SizeType pass;
+		SizeType step;
+		SizeType seed;
+		RealType s;
+		RealType bprev;
+		RealType energy; // pass 1 only
+		VectorRealType alpha;
+		VectorRealType beta;
+		VectorRealType t0; // lowest eigenvector of T, pass 1 only
+		VectorType u;
+		VectorType p;
+		VectorType z;
+	};
+
+	//! inputFile is hashed, unless it is empty
+	template<typename InputType>
+	LanczosCheckpoint(InputType& io,
+	                  PsimagLite::String options,
+	                  PsimagLite::String inputFile)
+	    : filename_(""),
+	      every_(100),
+	      restart_(options.find(restartToken()) != PsimagLite::String::npos),
+	      inputHash_(0),
+	      running_(false),
+	      sector_(0),
+	      currentOffset_(0),
+	      bestSector_(0),
+	      bestOffset_(0),
+	      bestEnergy_(0),
+	      best_(0),
+	      hasState_(false),
+	      stateSize_(0)
+	{
+		try {
+			io.readline(filename_,"LanczosCheckpoint=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(every_,"LanczosCheckpointSteps=");
+		} catch (std::exception&) {}
+
+		if (restart_ && filename_ == "")
+			error("SolverOptions=LanczosRestart needs LanczosCheckpoint=","");
+
+		if (enabled() && inputFile != "")
+			inputHash_ = GroundStateFileParams::hashFile(inputFile,restartToken());
+	}
+
+	~LanczosCheckpoint()
+	{
+		wait();
+	}
+
+	bool enabled() const { return (filename_ != ""); }
+
+	//! Reads the checkpoint if LanczosRestart was given; false if there is none
+	bool load()
+	{
+		if (!restart_) return false;
+
+		FILE* fp = fopen(filename_.c_str(),"rb");
+		if (!fp) {
+			std::cerr<<"LanczosCheckpoint: no checkpoint "<<filename_<<", starting anew\n";
+			return false;
+		}
+
+		Header h;
+		if (fread(&h,sizeof(h),1,fp) != 1 || memcmp(h.magic,magic(),8) != 0) {
+			fclose(fp);
+			error("not a checkpoint",filename_);
+		}
+
+		if (h.realSize != sizeof(RealType) || h.elementSize != sizeof(ComplexOrRealType)) {
+			fclose(fp);
+			error("written with a different RealType or ComplexOrRealType",filename_);
+		}
+
+		if (h.inputHash != inputHash_) {
+			fclose(fp);
+			error("written for an input file with other contents",filename_);
+		}
+
+		sector_ = h.sector;
+		currentOffset_ = h.currentOffset;
+		bestSector_ = h.bestSector;
+		bestOffset_ = h.bestOffset;
+		bestEnergy_ = h.bestEnergy;
+		hasState_ = (h.hasState != 0);
+		state_.pass = h.pass;
+		state_.step = h.step;
+		state_.seed = h.seed;
+		state_.s = h.s;
+		state_.bprev = h.bprev;
+		state_.energy = h.energy;
+		stateSize_ = h.n;
+		bool ok = readVector(state_.alpha,h.alphas,fp);
+		ok = ok && readVector(state_.beta,h.betas,fp);
+		ok = ok && readVector(state_.t0,h.t0Size,fp);
+		ok = ok && readVector(state_.u,h.n,fp);
+		ok = ok && readVector(state_.p,h.n,fp);
+		ok = ok && readVector(state_.z,h.zSize,fp);
+		ok = ok && readVector(loadedBest_,h.bestSize,fp);
+		fclose(fp);
+		if (!ok) error("truncated",filename_);
+
+		std::cout<<"#LanczosCheckpoint: resuming sector "<<sector_;
+		if (hasState_)
+			std::cout<<" at pass "<<state_.pass<<" step "<<state_.step;
+		std::cout<<"\n";
+		return true;
+	}
+
+	SizeType sector() const { return sector_; }
+
+	SizeType currentOffset() const { return currentOffset_; }
+
+	SizeType bestSector() const { return bestSector_; }
+
+	SizeType bestOffset() const { return bestOffset_; }
+
+	RealType bestEnergy() const { return bestEnergy_; }
+
+	//! Ground state of the sectors before sector(), empty if none
+	const VectorType& best() const { return loadedBest_; }
+
+	//! best must live until the next call
+	void setSector(SizeType sector,
+	               SizeType currentOffset,
+	               SizeType bestSector,
+	               SizeType bestOffset,
+	               RealType bestEnergy,
+	               const VectorType& best)
+	{
+		if (sector != sector_) hasState_ = false;
+		sector_ = sector;
+		currentOffset_ = currentOffset;
+		bestSector_ = bestSector;
+		bestOffset_ = bestOffset;
+		bestEnergy_ = bestEnergy;
+		best_ = &best;
+	}
+
+	//! Checkpoint with no Lanczos state, at the start of a sector
+	void saveSector()
+	{
+		if (!enabled()) return;
+		State empty;
+		write(empty,false);
+	}
+
+	bool due(SizeType step) const
+	{
+		return (enabled() && every_ > 0 && step % every_ == 0);
+	}
+
+	void save(const State& state)
+	{
+		write(state,true);
+	}
+
+	//! Gives the loaded state, once, if it is for this sector and size
+	bool resume(State& state, SizeType n)
+	{
+		if (!hasState_) return false;
+		hasState_ = false;
+		if (stateSize_ != n) {
+			std::cerr<<"LanczosCheckpoint: sector size has changed, starting it anew\n";
+			return false;
+		}
+
+		state = state_;
+		state_ = State();
+		return true;
+	}
+
+	//! Removes the checkpoint once the ground state is done
+	void remove()
+	{
+		if (!enabled()) return;
+		wait();
+		std::remove(filename_.c_str());
+	}
+
+private:
+
+	LanczosCheckpoint(const LanczosCheckpoint&);
+
+	LanczosCheckpoint& operator=(const LanczosCheckpoint&);
+
+	// Waits for the previous write, copies to the buffer, and writes it
+	void write(const State& state, bool hasState)
+	{
+		wait();
+
+		SizeType bestSize = (best_) ? best_->size() : 0;
+		Header h;
+		memset(&h,0,sizeof(h));
+		memcpy(h.magic,magic(),8);
+		h.inputHash = inputHash_;
+		h.realSize = sizeof(RealType);
+		h.elementSize = sizeof(ComplexOrRealType);
+		h.sector = sector_;
+		h.currentOffset = currentOffset_;
+		h.bestSector = bestSector_;
+		h.bestOffset = bestOffset_;
+		h.bestEnergy = bestEnergy_;
+		h.hasState = (hasState) ? 1 : 0;
+		h.pass = state.pass;
+		h.step = state.step;
+		h.seed = state.seed;
+		h.s = state.s;
+		h.bprev = state.bprev;
+		h.energy = state.energy;
+		h.n = state.u.size();
+		h.alphas = state.alpha.size();
+		h.betas = state.beta.size();
+		h.t0Size = state.t0.size();
+		h.zSize = state.z.size();
+		h.bestSize = bestSize;
+
+		SizeType bytes = sizeof(h) +
+		        (h.alphas + h.betas + h.t0Size)*sizeof(RealType) +
+		        (2*h.n + h.zSize + bestSize)*sizeof(ComplexOrRealType);
+		job_.filename = filename_;
+		job_.buffer.resize(bytes);
+		char* ptr = &(job_.buffer[0]);
+		ptr = copy(ptr,&h,sizeof(h));
+		ptr = copyVector(ptr,state.alpha);
+		ptr = copyVector(ptr,state.beta);
+		ptr = copyVector(ptr,state.t0);
+		ptr = copyVector(ptr,state.u);
+		ptr = copyVector(ptr,state.p);
+		ptr = copyVector(ptr,state.z);
+		if (bestSize > 0) copyVector(ptr,*best_);
+
+#ifdef USE_PTHREADS
+		running_ = (pthread_create(&thread_,0,writeJob,&job_) == 0);
+		if (running_) return;
+#endif
+		writeJob(&job_);
+	}
+
+	void wait()
+	{
+#ifdef USE_PTHREADS
+		if (running_) pthread_join(thread_,0);
+#endif
+		running_ = false;
+		if (job_.ok) return;
+		std::cerr<<"LanczosCheckpoint: could not write "<<job_.filename<<"\n";
+		job_.ok = true;
+	}
+
+	// Runs in its own thread, so it cannot throw
+	static void* writeJob(void* ptr)
+	{
+		Job* job = static_cast<Job*>(ptr);
+		PsimagLite::String tmp = job->filename + ".tmp" + ttos(getpid());
+		FILE* fp = fopen(tmp.c_str(),"wb");
+		if (!fp) {
+			job->ok = false;
+			return 0;
+		}
+
+		SizeType bytes = job->buffer.size();
+		bool ok = (fwrite(&(job->buffer[0]),1,bytes,fp) == bytes);
+		if (fclose(fp) != 0) ok = false;
+		if (ok) ok = (rename(tmp.c_str(),job->filename.c_str()) == 0);
+		if (!ok) std::remove(tmp.c_str());
+		job->ok = ok;
+		return 0;
+	}
+
+	static char* copy(char* dest, const void* src, SizeType bytes)
+	{
+		if (bytes > 0) memcpy(dest,src,bytes);
+		return dest + bytes;
+	}
+
+	template<typename SomeVectorType>
+	static char* copyVector(char* dest, const SomeVectorType& v)
+	{
+		if (v.size() == 0) return dest;
+		return copy(dest,&(v[0]),v.size()*sizeof(v[0]));
+	}
+
+	template<typename SomeVectorType>
+	static bool readVector(SomeVectorType& v, SizeType total, FILE* fp)
+	{
+		v.resize(total);
+		if (total == 0) return true;
+		return (fread(&(v[0]),sizeof(v[0]),total,fp) == total);
+	}
+
+	static void error(PsimagLite::String msg, PsimagLite::String filename)
+	{
+		PsimagLite::String str(__FILE__);
+		str += " " + ttos(__LINE__) + "\n";
+		str += "LanczosCheckpoint: " + msg + " " + filename + "\n";
+		throw PsimagLite::RuntimeError(str);
+	}
+
+	PsimagLite::String filename_;
+	SizeType every_;
+	bool restart_;
+	uint64_t inputHash_;
+	bool running_;
+#ifdef USE_PTHREADS
+	pthread_t thread_;
+#endif
+	Job job_;
+	SizeType sector_;
+	SizeType currentOffset_;
+	SizeType bestSector_;
+	SizeType bestOffset_;
+	RealType bestEnergy_;
+	const VectorType* best_;
+	VectorType loadedBest_;
+	bool hasState_;
+	SizeType stateSize_;
+	State state_;
+}; // class LanczosCheckpoint
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_LANCZOS_CHECKPOINT_H
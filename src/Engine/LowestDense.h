@@ -0,0 +1,281 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file LowestDense.h
+ *
+ *  The k lowest eigenpairs of a sparse Hermitian matrix, by LAPACK's
+ *  range driver (syevr or heevr with il=1, iu=k) on its dense lower
+ *  triangle. Only k eigenvectors are computed, and the tridiagonal
+ *  problem is solved by MRRR, so the cost is the reduction to
+ *  tridiagonal form, which is threaded by the BLAS library. Filling
+ *  the dense matrix from the CRS one is threaded by columns here.
+ *
+ */
+#ifndef LANCZOS_LOWEST_DENSE_H
+#define LANCZOS_LOWEST_DENSE_H
+#include <complex>
+#include <algorithm>
+#include <cmath>
+#include "Vector.h"
+#include "Matrix.h"
+#include "CrsMatrix.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+#include "TypeToString.h"
+
+extern "C" void dsyevr_(char*,char*,char*,int*,double*,int*,double*,double*,
+                        int*,int*,double*,int*,double*,double*,int*,int*,
+                        double*,int*,int*,int*,int*);
+
+extern "C" void ssyevr_(char*,char*,char*,int*,float*,int*,float*,float*,
+                        int*,int*,float*,int*,float*,float*,int*,int*,
+                        float*,int*,int*,int*,int*);
+
+extern "C" void zheevr_(char*,char*,char*,int*,std::complex<double>*,int*,
+                        double*,double*,int*,int*,double*,int*,double*,
+                        std::complex<double>*,int*,int*,std::complex<double>*,
+                        int*,double*,int*,int*,int*,int*);
+
+extern "C" void cheevr_(char*,char*,char*,int*,std::complex<float>*,int*,
+                        float*,float*,int*,int*,float*,int*,float*,
+                        std::complex<float>*,int*,int*,std::complex<float>*,
+                        int*,float*,int*,int*,int*,int*);
+
+namespace LanczosPlusPlus {
+
+template<typename ComplexOrRealType>
+class LowestDense {
+
+	typedef PsimagLite::CrsMatrix<ComplexOrRealType> SparseMatrixType;
+	typedef PsimagLite::Matrix<ComplexOrRealType> DenseMatrixType;
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	// Column i of the lower triangle is row i of the matrix conjugated,
+	// so each task writes contiguous memory of its own
+	class FillTasks {
+
+	public:
+
+		FillTasks(const SparseMatrixType& matrix, DenseMatrixType& a)
+		    : matrix_(matrix),a_(a)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			SizeType start = threadNum*blockSize;
+			SizeType end = std::min<SizeType>(start + blockSize,total);
+			for (SizeType i = start; i < end; ++i) {
+				for (int k = matrix_.getRowPtr(i); k < matrix_.getRowPtr(i+1); ++k) {
+					SizeType j = matrix_.getCol(k);
+					if (j < i) continue;
+					a_(j,i) += PsimagLite::conj(matrix_.getValue(k));
+				}
+			}
+		}
+
+	private:
+
+		const SparseMatrixType& matrix_;
+		DenseMatrixType& a_;
+	}; // class FillTasks
+
+public:
+
+	// The dense matrix is limited to about 8 GB: 32768 rows in double,
+	// 23170 in double complex
+	static SizeType maxRows()
+	{
+		double bytes = 8.0*1024*1024*1024;
+		return static_cast<SizeType>(sqrt(bytes/sizeof(ComplexOrRealType)));
+	}
+
+	//! eigenvectors are the columns of vecs, like diag(...,'V') does
+	static void lowest(VectorRealType& eigs,
+	                   DenseMatrixType& vecs,
+	                   const SparseMatrixType& matrix,
+	                   SizeType k)
+	{
+		SizeType n = matrix.row();
+		if (n > maxRows()) {
+			PsimagLite::String str("LowestDense: sector of ");
+			str += ttos(n) + " rows, larger than " + ttos(maxRows()) + "\n";
+			throw PsimagLite::RuntimeError(str);
+		}
+
+		k = std::min(k,n);
+		if (k == 0)
+			throw PsimagLite::RuntimeError("LowestDense: empty sector or no states\n");
+
+		DenseMatrixType a(n,n);
+		FillTasks tasks(matrix,a);
+		PsimagLite::Parallelizer<FillTasks> threaded(PsimagLite::Concurrency::npthreads,
+		                                             PsimagLite::MPI::COMM_WORLD);
+		threaded.loopCreate(n,tasks);
+
+		VectorRealType w(n);
+		DenseMatrixType z(n,k);
+		int found = 0;
+		int info = rangeDriver(n,&(a(0,0)),k,&(w[0]),&(z(0,0)),found);
+		if (info != 0 || SizeType(found) != k) {
+			PsimagLite::String str("LowestDense: range driver failed, info= ");
+			str += ttos(info) + " eigenvalues found= " + ttos(found) + "\n";
+			throw PsimagLite::RuntimeError(str);
+		}
+
+		eigs.resize(k);
+		for (SizeType c = 0; c < k; ++c)
+			eigs[c] = w[c];
+
+		vecs = z;
+	}
+
+private:
+
+	static int rangeDriver(int n, double* a, int k, double* w, double* z, int& m)
+	{
+		char jobz = 'V';
+		char range = 'I';
+		char uplo = 'L';
+		int il = 1;
+		double vl = 0;
+		double abstol = 0;
+		typename PsimagLite::Vector<int>::Type isuppz(2*k);
+		int lwork = -1;
+		int liwork = -1;
+		double workSize = 0;
+		int iworkSize = 0;
+		int info = 0;
+		dsyevr_(&jobz,&range,&uplo,&n,a,&n,&vl,&vl,&il,&k,&abstol,&m,w,z,&n,
+		        &(isuppz[0]),&workSize,&lwork,&iworkSize,&liwork,&info);
+		if (info != 0) return info;
+
+		lwork = int(workSize);
+		liwork = iworkSize;
+		typename PsimagLite::Vector<double>::Type work(lwork);
+		typename PsimagLite::Vector<int>::Type iwork(liwork);
+		dsyevr_(&jobz,&range,&uplo,&n,a,&n,&vl,&vl,&il,&k,&abstol,&m,w,z,&n,
+		        &(isuppz[0]),&(work[0]),&lwork,&(iwork[0]),&liwork,&info);
+		return info;
+	}
+
+	static int rangeDriver(int n, float* a, int k, float* w, float* z, int& m)
+	{
+		char jobz = 'V';
+		char range = 'I';
+		char uplo = 'L';
+		int il = 1;
+		float vl = 0;
+		float abstol = 0;
+		typename PsimagLite::Vector<int>::Type isuppz(2*k);
+		int lwork = -1;
+		int liwork = -1;
+		float workSize = 0;
+		int iworkSize = 0;
+		int info = 0;
+		ssyevr_(&jobz,&range,&uplo,&n,a,&n,&vl,&vl,&il,&k,&abstol,&m,w,z,&n,
+		        &(isuppz[0]),&workSize,&lwork,&iworkSize,&liwork,&info);
+		if (info != 0) return info;
+
+		lwork = int(workSize);
+		liwork = iworkSize;
+		typename PsimagLite::Vector<float>::Type work(lwork);
+		typename PsimagLite::Vector<int>::Type iwork(liwork);
+		ssyevr_(&jobz,&range,&uplo,&n,a,&n,&vl,&vl,&il,&k,&abstol,&m,w,z,&n,
+		        &(isuppz[0]),&(work[0]),&lwork,&(iwork[0]),&liwork,&info);
+		return info;
+	}
+
+	static int rangeDriver(int n,
+	                       std::complex<double>* a,
+	                       int k,
+	                       double* w,
+	                       std::complex<double>* z,
+	                       int& m)
+	{
+		char jobz = 'V';
+		char range = 'I';
+		char uplo = 'L';
+		int il = 1;
+		double vl = 0;
+		double abstol = 0;
+		typename PsimagLite::Vector<int>::Type isuppz(2*k);
+		int lwork = -1;
+		int lrwork = -1;
+		int liwork = -1;
+		std::complex<double> workSize = 0;
+		double rworkSize = 0;
+		int iworkSize = 0;
+		int info = 0;
+		zheevr_(&jobz,&range,&uplo,&n,a,&n,&vl,&vl,&il,&k,&abstol,&m,w,z,&n,
+		        &(isuppz[0]),&workSize,&lwork,&rworkSize,&lrwork,&iworkSize,&liwork,&info);
+		if (info != 0) return info;
+
+		lwork = int(std::real(workSize));
+		lrwork = int(rworkSize);
+		liwork = iworkSize;
+		typename PsimagLite::Vector<std::complex<double> >::Type work(lwork);
+		typename PsimagLite::Vector<double>::Type rwork(lrwork);
+		typename PsimagLite::Vector<int>::Type iwork(liwork);
+		zheevr_(&jobz,&range,&uplo,&n,a,&n,&vl,&vl,&il,&k,&abstol,&m,w,z,&n,
+		        &(isuppz[0]),&(work[0]),&lwork,&(rwork[0]),&lrwork,&(iwork[0]),&liwork,&info);
+		return info;
+	}
+
+	static int rangeDriver(int n,
+	                       std::complex<float>* a,
+	                       int k,
+	                       float* w,
+	                       std::complex<float>* z,
+	                       int& m)
+	{
+		char jobz = 'V';
+		char range = 'I';
+		char uplo = 'L';
+		int il = 1;
+		float vl = 0;
+		float abstol = 0;
+		typename PsimagLite::Vector<int>::Type isuppz(2*k);
+		int lwork = -1;
+		int lrwork = -1;
+		int liwork = -1;
+		std::complex<float> workSize = 0;
+		float rworkSize = 0;
+		int iworkSize = 0;
+		int info = 0;
+		cheevr_(&jobz,&range,&uplo,&n,a,&n,&vl,&vl,&il,&k,&abstol,&m,w,z,&n,
+		        &(isuppz[0]),&workSize,&lwork,&rworkSize,&lrwork,&iworkSize,&liwork,&info);
+		if (info != 0) return info;
+
+		lwork = int(std::real(workSize));
+		lrwork = int(rworkSize);
+		liwork = iworkSize;
+		typename PsimagLite::Vector<std::complex<float> >::Type work(lwork);
+		typename PsimagLite::Vector<float>::Type rwork(lrwork);
+		typename PsimagLite::Vector<int>::Type iwork(liwork);
+		cheevr_(&jobz,&range,&uplo,&n,a,&n,&vl,&vl,&il,&k,&abstol,&m,w,z,&n,
+		        &(isuppz[0]),&(work[0]),&lwork,&(rwork[0]),&lrwork,&(iwork[0]),&liwork,&info);
+		return info;
+	}
+}; // class LowestDense
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_LOWEST_DENSE_H
@@ -23,6 +23,8 @@ Please see full open source license included in file LICENSE.
 #include "CrsMatrix.h"
 #include "BasisBase.h"
 #include "Vector.h"
+#include "SectorArchive.h"
+#include "OperatorCache.h"
 
 namespace LanczosPlusPlus {
 
@@ -40,8 +42,22 @@ public:
 	typedef PsimagLite::CrsMatrix<ComplexOrRealType> SparseMatrixType;
 	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
 	typedef typename PsimagLite::Vector<SizeType>::Type VectorSizeType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef SectorArchiveWriter<ComplexOrRealType> SectorArchiveWriterType;
+	typedef OperatorCache<BasisBaseType> OperatorCacheType;
+	typedef typename OperatorCacheType::OperatorIndex OperatorIndexType;
+	typedef std::pair<SizeType,SizeType> PairSizeType;
 
-	virtual ~ModelBase() {}
+	ModelBase() : operatorCache_(0) {}
+
+	virtual ~ModelBase()
+	{
+		delete operatorCache_;
+
+		typename std::map<PairSizeType,BasisBaseType*>::iterator it = sectors_.begin();
+		for (; it != sectors_.end(); ++it)
+			delete it->second;
+	}
 
 	virtual SizeType size() const = 0;
 
@@ -73,12 +89,52 @@ public:
 		        ("ModelBase::matrixVectorProduct(3) not impl. for this model\n");
 	}
 
+	//! Diagonal V of H(t) = H0 + f(t)V in the given basis
+	virtual void setupTimeDependentPotential(VectorRealType&,
+	                                         const BasisBaseType&) const
+	{
+		throw PsimagLite::RuntimeError
+		        ("ModelBase::setupTimeDependentPotential not impl. for this model\n");
+	}
+
+	//! Diagonal of H in the given basis, for preconditioners
+	virtual void diagonal(VectorRealType&, const BasisBaseType&) const
+	{
+		throw PsimagLite::RuntimeError
+		        ("ModelBase::diagonal not impl. for this model\n");
+	}
+
+	//! The f(t) value already included in setupHamiltonian
+	virtual RealType timeFactor() const { return 0; }
+
 	virtual const BasisBaseType& basis() const = 0;
 
 	virtual PsimagLite::String name() const  = 0;
 
 	virtual BasisBaseType* createBasis(SizeType nup, SizeType ndown) const = 0;
 
+	//! Basis of sector newParts, created only once and kept until the
+	//! model is destroyed, because operatorCache() keys on its address
+	const BasisBaseType& sectorBasis(const PairSizeType& newParts) const
+	{
+		typename std::map<PairSizeType,BasisBaseType*>::iterator it = sectors_.find(newParts);
+		if (it != sectors_.end()) return *(it->second);
+		BasisBaseType* basis = createBasis(newParts.first,newParts.second);
+		sectors_[newParts] = basis;
+		return *basis;
+	}
+
+	//! c, c^dagger, S^+, S^- and n from basis(), shared by Engine and the dumps.
+	//! Nothing is evicted: the cache holds every operator built, at most one
+	//! per (operator, site, spin, orbital, destination sector). Since the
+	//! source is always basis(), the destinations are only the few sectors
+	//! one c, c^dagger, S^+ or S^- away from it.
+	OperatorCacheType& operatorCache() const
+	{
+		if (!operatorCache_) operatorCache_ = new OperatorCacheType(basis());
+		return *operatorCache_;
+	}
+
 	virtual void print(std::ostream& os) const = 0;
 
 	virtual void printOperators(std::ostream&) const
@@ -89,8 +145,60 @@ public:
 		std::cerr<<str.c_str();
 	}
 
+	//! Binary counterpart of printOperators, for DumpArchive=
+	virtual void archiveOperators(SectorArchiveWriterType&) const
+	{
+		PsimagLite::String str(__FILE__);
+		str += " " + ttos(__LINE__) +  "\n";
+		str += PsimagLite::String("Function archiveOperators unimplemented\n");
+		throw PsimagLite::RuntimeError(str);
+	}
+
 protected:
 
+	//! Nonzeros of an operator as (row, col, value) triplets, for thermal
+	static void printOperatorMatrix(std::ostream& os, const SparseMatrixType& matrix)
+	{
+		SizeType rows = matrix.row();
+		SizeType total = (rows > 0) ? matrix.getRowPtr(rows) : 0;
+		os<<"#MatrixSize 2 "<<rows<<" "<<matrix.col()<<"\n";
+		os<<"#MatrixRows "<<total;
+		for (SizeType i = 0; i < rows; ++i)
+			for (int k = matrix.getRowPtr(i); k < matrix.getRowPtr(i+1); ++k)
+				os<<" "<<i;
+		os<<"\n#MatrixCols "<<total;
+		for (SizeType k = 0; k < total; ++k)
+			os<<" "<<matrix.getCol(k);
+		os<<"\n#MatrixValues "<<total;
+		for (SizeType k = 0; k < total; ++k)
+			os<<" "<<matrix.getValue(k);
+		os<<"\n";
+	}
+
+	//! Sparse matrix of op, rows are states of basis()
+	static void operatorMatrix(SparseMatrixType& matrix,
+	                           const OperatorIndexType& op,
+	                           SizeType hilbertSrc)
+	{
+		SizeType hilbertDest = op.source.size();
+		PsimagLite::Vector<int>::Type dest(hilbertSrc,-1);
+		for (SizeType i = 0; i < hilbertDest; ++i)
+			if (op.source[i] >= 0) dest[op.source[i]] = i;
+
+		matrix.resize(hilbertSrc,hilbertDest);
+		SizeType counter = 0;
+		for (SizeType ispace = 0; ispace < hilbertSrc; ++ispace) {
+			matrix.setRow(ispace,counter);
+			if (dest[ispace] < 0) continue;
+			matrix.pushCol(dest[ispace]);
+			matrix.pushValue(op.value[dest[ispace]]);
+			counter++;
+		}
+
+		matrix.setRow(hilbertSrc,counter);
+		matrix.checkValidity();
+	}
+
 	template<typename SomeVectorType>
 	static typename PsimagLite::EnableIf<PsimagLite::IsVectorLike<SomeVectorType>::True,
 	void>::Type deleteGarbage(SomeVectorType& garbage)
@@ -101,6 +209,14 @@ protected:
 		}
 	}
 
+private:
+
+	ModelBase(const ModelBase&);
+
+	ModelBase& operator=(const ModelBase&);
+
+	mutable std::map<PairSizeType,BasisBaseType*> sectors_;
+	mutable OperatorCacheType* operatorCache_;
 }; // class ModelBase
 
 template<typename RealType,typename GeometryType,typename InputType>
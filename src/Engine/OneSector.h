@@ -2,7 +2,9 @@
 #define ONESECTOR_H
 #include "Vector.h"
 #include "Matrix.h"
+#include "CrsMatrix.h"
 #include "BLAS.h"
+#include "SectorArchive.h"
 
 namespace LanczosPlusPlus {
 
@@ -14,12 +16,30 @@ public:
 	typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
 	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
 	typedef PsimagLite::Matrix<RealType> MatrixType;
+	typedef PsimagLite::CrsMatrix<RealType> SparseMatrixType;
+	typedef SectorArchive<RealType> SectorArchiveType;
 
 	OneSector(InputType& io)
 	{
 		io.read(sector_,"#SectorSource");
 		io.read(eigs_,"#Eigenvalues");
 		io.readMatrix(vecs_,"#Eigenvectors");
+		states_ = eigs_.size();
+		rows_ = vecs_.n_row();
+		eigsPtr_ = (states_ > 0) ? &(eigs_[0]) : 0;
+		vecsPtr_ = (rows_*vecs_.n_col() > 0) ? &(vecs_(0,0)) : 0;
+	}
+
+	// No copies: eigenvalues and eigenvectors stay in the mapped archive
+	OneSector(const SectorArchiveType& archive, SizeType ind)
+	    : sector_(2,0),
+	      states_(archive.states(ind)),
+	      rows_(archive.basisSize(ind)),
+	      eigsPtr_(archive.eigenvalues(ind)),
+	      vecsPtr_(archive.eigenvectors(ind))
+	{
+		sector_[0] = archive.nup(ind);
+		sector_[1] = archive.ndown(ind);
 	}
 
 	bool isSector(const VectorSizeType& jndVector) const
@@ -27,50 +47,73 @@ public:
 		return (jndVector == sector_);
 	}
 
+	const VectorSizeType& sector() const { return sector_; }
+
 	void info(std::ostream& os) const
 	{
 		os<<"sector\n";
 		os<<sector_;
-		os<<"eigs.size()="<<eigs_.size()<<"\n";
-		os<<"vecs="<<vecs_.n_row()<<"x"<<vecs_.n_col()<<"\n";
+		os<<"eigs.size()="<<states_<<"\n";
+		os<<"basisSize="<<rows_<<"\n";
 	}
 
-	SizeType size() const { return eigs_.size(); }
+	// Number of eigenstates, which is smaller than basisSize() if truncated
+	SizeType size() const { return states_; }
+
+	SizeType basisSize() const { return rows_; }
 
-	void multiplyRight(MatrixType& x,const MatrixType& a) const
+	//! x = a*vecs, where a has basisSize() columns; costs nonzeros(a)*size()
+	void multiplyRight(MatrixType& x,const SparseMatrixType& a) const
 	{
-		SizeType n = a.n_row();
-		SizeType m = a.n_col();
-		assert(vecs_.n_row() == m);
-		assert(vecs_.n_col() == m);
+		SizeType n = a.row();
+		SizeType k = states_;
+		assert(rows_ == a.col());
 		assert(x.n_row() == n);
-		assert(x.n_col() == m);
-		assert(m > 0 && n > 0);
-		psimag::BLAS::GEMM('N','N',n,m,m,1.0,&(a(0,0)),n,&(vecs_(0,0)),m,0.0,&(x(0,0)),n);
+		assert(x.n_col() == k);
+		for (SizeType c = 0; c < k; ++c) {
+			const RealType* vec = vecsPtr_ + c*rows_;
+			for (SizeType i = 0; i < n; ++i) {
+				RealType sum = 0.0;
+				for (int p = a.getRowPtr(i); p < a.getRowPtr(i+1); ++p)
+					sum += a.getValue(p)*vec[a.getCol(p)];
+				x(i,c) = sum;
+			}
+		}
 	}
 
+	//! x = vecs^dagger*a, where a has basisSize() rows
 	void multiplyLeft(MatrixType& x,const MatrixType& a) const
 	{
 		SizeType n = a.n_row();
 		SizeType m = a.n_col();
-		assert(vecs_.n_row() == n);
-		psimag::BLAS::GEMM('C','N',n,m,n,1.0,&(vecs_(0,0)),n,&(a(0,0)),n,0.0,&(x(0,0)),n);
+		SizeType k = states_;
+		assert(rows_ == n);
+		assert(x.n_row() == k);
+		assert(x.n_col() == m);
+		psimag::BLAS::GEMM('C','N',k,m,n,1.0,vecsPtr_,n,&(a(0,0)),n,0.0,&(x(0,0)),k);
 	}
 
 	const RealType& eig(SizeType i) const
 	{
-		assert(i < eigs_.size());
-		return eigs_[i];
+		assert(i < states_);
+		return eigsPtr_[i];
 	}
 
 private:
 
+	OneSector(const OneSector&);
+
+	OneSector& operator=(const OneSector&);
+
 	VectorSizeType sector_;
 	VectorRealType eigs_;
 	MatrixType vecs_;
+	SizeType states_;
+	SizeType rows_;
+	const RealType* eigsPtr_;
+	const RealType* vecsPtr_;
 };
 
 } // namespace LanczosPlusPlus
 
 #endif // ONESECTOR_H
-
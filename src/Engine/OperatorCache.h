@@ -0,0 +1,295 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file OperatorCache.h
+ *
+ *  c, c^dagger, S^+, S^- and n between two bases have at most one
+ *  nonzero per row and per column. Each is stored once, per destination
+ *  state, as the index of its source state (or -1) and the sign times
+ *  the value, so applying it is a gather.
+ *
+ */
+#ifndef LANCZOS_OPERATOR_CACHE_H
+#define LANCZOS_OPERATOR_CACHE_H
+#include <map>
+#include <algorithm>
+#include "Vector.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+#include "TypeToString.h"
+#include "ProgramGlobals.h"
+
+namespace LanczosPlusPlus {
+
+template<typename BasisType>
+class OperatorCache {
+
+	struct Key {
+
+		Key(SizeType label_,
+		    SizeType site_,
+		    SizeType spin_,
+		    SizeType orb_,
+		    const BasisType* dest_)
+		    : label(label_),site(site_),spin(spin_),orb(orb_),dest(dest_)
+		{}
+
+		bool operator<(const Key& other) const
+		{
+			if (label != other.label) return (label < other.label);
+			if (site != other.site) return (site < other.site);
+			if (spin != other.spin) return (spin < other.spin);
+			if (orb != other.orb) return (orb < other.orb);
+			return (dest < other.dest);
+		}
+
+		SizeType label;
+		SizeType site;
+		SizeType spin;
+		SizeType orb;
+		const BasisType* dest;
+	}; // struct Key
+
+public:
+
+	struct OperatorIndex {
+
+		PsimagLite::Vector<int>::Type source;
+		PsimagLite::Vector<signed char>::Type value;
+	}; // struct OperatorIndex
+
+private:
+
+	// One task per source state; no two source states share a destination
+	class BuildTasks {
+
+	public:
+
+		BuildTasks(const BasisType& basis,
+		           const BasisType& dest,
+		           const Key& key,
+		           OperatorIndex& op,
+		           SizeType threads)
+		    : basis_(basis),
+		      dest_(dest),
+		      key_(key),
+		      op_(op),
+		      isFermionic_(ProgramGlobals::isFermionic(key.label)),
+		      isSplusOrSminus_(key.label == ProgramGlobals::OPERATOR_SPLUS ||
+		                       key.label == ProgramGlobals::OPERATOR_SMINUS),
+		      outOfRange_(threads,0)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			for (SizeType p = 0; p < blockSize; ++p) {
+				SizeType ispace = threadNum*blockSize + p;
+				if (ispace >= total) break;
+				ProgramGlobals::WordType ket1 = basis_(ispace,ProgramGlobals::SPIN_UP);
+				ProgramGlobals::WordType ket2 = basis_(ispace,ProgramGlobals::SPIN_DOWN);
+				ProgramGlobals::PairIntType tempValue = dest_.getBraIndex(ket1,
+				                                                          ket2,
+				                                                          key_.label,
+				                                                          key_.site,
+				                                                          key_.spin,
+				                                                          key_.orb);
+				int temp = tempValue.first;
+				int value = tempValue.second;
+				if (temp<0) continue;
+				if (SizeType(temp)>=op_.source.size()) {
+					if (outOfRange_[threadNum] == 0) outOfRange_[threadNum] = ispace + 1;
+					continue;
+				}
+
+				int mysign = (isFermionic_) ?
+				            basis_.doSignGf(ket1,ket2,key_.site,key_.spin,key_.orb) : 1;
+				if (isSplusOrSminus_)
+					mysign *= basis_.doSignSpSm(ket1,ket2,key_.site,key_.spin,key_.orb);
+
+				op_.source[temp] = ispace;
+				op_.value[temp] = mysign*value;
+			}
+		}
+
+		void check() const
+		{
+			for (SizeType t = 0; t < outOfRange_.size(); ++t) {
+				if (outOfRange_[t] == 0) continue;
+				SizeType ispace = outOfRange_[t] - 1;
+				ProgramGlobals::WordType ket1 = basis_(ispace,ProgramGlobals::SPIN_UP);
+				ProgramGlobals::WordType ket2 = basis_(ispace,ProgramGlobals::SPIN_DOWN);
+				int temp = dest_.getBraIndex(ket1,
+				                             ket2,
+				                             key_.label,
+				                             key_.site,
+				                             key_.spin,
+				                             key_.orb).first;
+				PsimagLite::String s = "old basis=" + ttos(basis_.size());
+				s += " newbasis=" + ttos(dest_.size());
+				s += "\n";
+				s += "operatorLabel=" + ttos(key_.label) + " spin=" + ttos(key_.spin);
+				s += " site=" + ttos(key_.site);
+				s += "ket1=" + ttos(ket1) + " and ket2=" + ttos(ket2);
+				s += "\n";
+				s += "OperatorCache: dest.size=" + ttos(dest_.size());
+				s += " but temp=" + ttos(temp) + "\n";
+				throw PsimagLite::RuntimeError(s);
+			}
+		}
+
+	private:
+
+		const BasisType& basis_;
+		const BasisType& dest_;
+		const Key& key_;
+		OperatorIndex& op_;
+		bool isFermionic_;
+		bool isSplusOrSminus_;
+		PsimagLite::Vector<SizeType>::Type outOfRange_;
+	}; // class BuildTasks
+
+	// One task per destination state
+	template<typename VectorType, typename FieldType>
+	class GatherTasks {
+
+	public:
+
+		GatherTasks(VectorType& z,
+		            const OperatorIndex& op,
+		            const VectorType& src,
+		            const FieldType& factor)
+		    : z_(z),op_(op),src_(src),factor_(factor)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			SizeType start = threadNum*blockSize;
+			SizeType end = std::min<SizeType>(start + blockSize,total);
+			for (SizeType i = start; i < end; ++i) {
+				int s = op_.source[i];
+				if (s < 0) continue;
+				z_[i] += factor_*src_[s]*static_cast<FieldType>(op_.value[i]);
+			}
+		}
+
+	private:
+
+		VectorType& z_;
+		const OperatorIndex& op_;
+		const VectorType& src_;
+		FieldType factor_;
+	}; // class GatherTasks
+
+	typedef std::map<Key,OperatorIndex> MapType;
+
+public:
+
+	OperatorCache(const BasisType& basis)
+	    : basis_(basis)
+	{}
+
+	//! Builds the operator the first time; call only outside of threads
+	const OperatorIndex& operator()(SizeType label,
+	                                SizeType site,
+	                                SizeType spin,
+	                                SizeType orb,
+	                                const BasisType& dest,
+	                                SizeType threads)
+	{
+		Key key(label,site,spin,orb,&dest);
+		typename MapType::iterator it = map_.find(key);
+		if (it != map_.end()) return it->second;
+
+		OperatorIndex& op = map_[key];
+		op.source.resize(dest.size(),-1);
+		op.value.resize(dest.size(),0);
+		BuildTasks tasks(basis_,dest,key,op,threads);
+		SizeType total = basis_.size();
+		if (threads > 1) {
+			PsimagLite::Parallelizer<BuildTasks> threaded(threads,PsimagLite::MPI::COMM_WORLD);
+			threaded.loopCreate(total,tasks);
+		} else {
+			tasks.thread_function_(0,total,total,0);
+		}
+
+		try {
+			tasks.check();
+		} catch (std::exception&) {
+			map_.erase(key);
+			throw;
+		}
+
+		return op;
+	}
+
+	//! An operator already built, for use within threads
+	const OperatorIndex& find(SizeType label,
+	                          SizeType site,
+	                          SizeType spin,
+	                          SizeType orb,
+	                          const BasisType& dest) const
+	{
+		typename MapType::const_iterator it = map_.find(Key(label,site,spin,orb,&dest));
+		if (it != map_.end()) return it->second;
+
+		PsimagLite::String str(__FILE__);
+		str += " " + ttos(__LINE__) + "\n";
+		str += "OperatorCache: operator " + ttos(label) + " at site " + ttos(site);
+		str += " was not built\n";
+		throw PsimagLite::RuntimeError(str);
+	}
+
+	//! z += factor * op * src
+	template<typename VectorType, typename FieldType>
+	static void apply(VectorType& z,
+	                  const OperatorIndex& op,
+	                  const VectorType& src,
+	                  const FieldType& factor,
+	                  SizeType threads)
+	{
+		typedef GatherTasks<VectorType,FieldType> GatherTasksType;
+
+		GatherTasksType tasks(z,op,src,factor);
+		SizeType total = op.source.size();
+		if (threads > 1) {
+			PsimagLite::Parallelizer<GatherTasksType> threaded(threads,
+			                                                   PsimagLite::MPI::COMM_WORLD);
+			threaded.loopCreate(total,tasks);
+		} else {
+			tasks.thread_function_(0,total,total,0);
+		}
+	}
+
+private:
+
+	OperatorCache(const OperatorCache&);
+
+	OperatorCache& operator=(const OperatorCache&);
+
+	const BasisType& basis_;
+	MapType map_;
+}; // class OperatorCache
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_OPERATOR_CACHE_H
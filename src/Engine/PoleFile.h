@@ -0,0 +1,183 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file PoleFile.h
+ *
+ *  Poles and weights, written by thermal and read by lorentzian.
+ *  Binary: the magic LPPPOLE1, the size of RealType as a uint64_t, and
+ *  then pairs (pole, weight). Text: pairs of numbers separated by blanks.
+ *  The reader recognizes either, and reads them in chunks.
+ *
+ */
+#ifndef LANCZOS_POLE_FILE_H
+#define LANCZOS_POLE_FILE_H
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <fstream>
+#include <stdint.h>
+#include "Vector.h"
+#include "TypeToString.h"
+
+namespace LanczosPlusPlus {
+
+struct PoleFileFormat {
+
+	static const char* magic() { return "LPPPOLE1"; }
+
+	static void error(PsimagLite::String msg, PsimagLite::String filename)
+	{
+		PsimagLite::String str(__FILE__);
+		str += " " + ttos(__LINE__) + "\n";
+		str += "PoleFile: " + msg + " " + filename + "\n";
+		throw PsimagLite::RuntimeError(str);
+	}
+}; // struct PoleFileFormat
+
+template<typename RealType>
+class PoleFileWriter {
+
+public:
+
+	PoleFileWriter(PsimagLite::String filename)
+	    : filename_(filename),fp_(fopen(filename.c_str(),"wb"))
+	{
+		if (!fp_) PoleFileFormat::error("cannot open",filename_);
+		uint64_t realSize = sizeof(RealType);
+		write(PoleFileFormat::magic(),8);
+		write(&realSize,sizeof(realSize));
+	}
+
+	~PoleFileWriter()
+	{
+		fclose(fp_);
+	}
+
+	//! poles holds pole and weight, alternating
+	void write(const typename PsimagLite::Vector<RealType>::Type& poles)
+	{
+		assert(poles.size() % 2 == 0);
+		if (poles.size() == 0) return;
+		write(&(poles[0]),poles.size()*sizeof(RealType));
+	}
+
+private:
+
+	PoleFileWriter(const PoleFileWriter&);
+
+	PoleFileWriter& operator=(const PoleFileWriter&);
+
+	void write(const void* ptr, SizeType bytes)
+	{
+		if (fwrite(ptr,1,bytes,fp_) != bytes)
+			PoleFileFormat::error("cannot write",filename_);
+	}
+
+	PsimagLite::String filename_;
+	FILE* fp_;
+}; // class PoleFileWriter
+
+template<typename RealType>
+class PoleFileReader {
+
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+public:
+
+	PoleFileReader(PsimagLite::String filename)
+	    : filename_(filename),fp_(0)
+	{
+		if (!isBinary(filename_)) {
+			fin_.open(filename_.c_str());
+			if (!fin_.good()) PoleFileFormat::error("cannot open",filename_);
+			return;
+		}
+
+		fp_ = fopen(filename_.c_str(),"rb");
+		char magic[8];
+		uint64_t realSize = 0;
+		if (!fp_ ||
+		        fread(magic,1,8,fp_) != 8 ||
+		        fread(&realSize,sizeof(realSize),1,fp_) != 1)
+			PoleFileFormat::error("cannot read",filename_);
+		if (realSize != sizeof(RealType))
+			PoleFileFormat::error("written with a different RealType",filename_);
+	}
+
+	~PoleFileReader()
+	{
+		if (fp_) fclose(fp_);
+	}
+
+	static bool isBinary(PsimagLite::String filename)
+	{
+		FILE* fp = fopen(filename.c_str(),"rb");
+		if (!fp) return false;
+		char magic[8];
+		bool b = (fread(magic,1,8,fp) == 8 && memcmp(magic,PoleFileFormat::magic(),8) == 0);
+		fclose(fp);
+		return b;
+	}
+
+	//! Appends up to max poles to e and w; returns how many, zero at the end
+	SizeType read(VectorRealType& e, VectorRealType& w, SizeType max)
+	{
+		return (fp_) ? readBinary(e,w,max) : readText(e,w,max);
+	}
+
+private:
+
+	PoleFileReader(const PoleFileReader&);
+
+	PoleFileReader& operator=(const PoleFileReader&);
+
+	SizeType readBinary(VectorRealType& e, VectorRealType& w, SizeType max)
+	{
+		if (max == 0) return 0;
+		buffer_.resize(2*max);
+		SizeType pairs = fread(&(buffer_[0]),2*sizeof(RealType),max,fp_);
+		for (SizeType i = 0; i < pairs; ++i) {
+			e.push_back(buffer_[2*i]);
+			w.push_back(buffer_[2*i + 1]);
+		}
+
+		return pairs;
+	}
+
+	SizeType readText(VectorRealType& e, VectorRealType& w, SizeType max)
+	{
+		SizeType counter = 0;
+		RealType tmp1 = 0;
+		RealType tmp2 = 0;
+		while (counter < max && (fin_>>tmp1>>tmp2)) {
+			e.push_back(tmp1);
+			w.push_back(tmp2);
+			counter++;
+		}
+
+		return counter;
+	}
+
+	PsimagLite::String filename_;
+	FILE* fp_;
+	std::ifstream fin_;
+	VectorRealType buffer_;
+}; // class PoleFileReader
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_POLE_FILE_H
@@ -22,6 +22,9 @@ Please see full open source license included in file LICENSE.
 #include "ProgressIndicator.h"
 #include "CrsMatrix.h"
 #include "Vector.h"
+#include "FusedProduct.h"
+#include "BlockProduct.h"
+#include "LowestDense.h"
 
 namespace LanczosPlusPlus {
 
@@ -178,6 +181,10 @@ public:
 
 	PsimagLite::String name() const { return "reflection"; }
 
+	// dumpmatrix is only supported by DefaultSymmetry
+	template<typename DumpOptionsType>
+	void setDumpOptions(const DumpOptionsType&) {}
+
 	void fullDiag(VectorRealType& eigs,MatrixType& fm) const
 	{
 		if (matrixStored_[pointer_].row() > 1000)
@@ -193,12 +200,42 @@ public:
 		std::cout<<fm;
 	}
 
+	//! The k lowest eigenpairs of the current sector only
+	void lowestDense(VectorRealType& eigs,MatrixType& fm,SizeType k) const
+	{
+		LowestDense<ComplexOrRealType>::lowest(eigs,fm,matrixStored_[pointer_],k);
+	}
+
 	template<typename SomeVectorType>
 	void matrixVectorProduct(SomeVectorType &x, SomeVectorType const &y) const
 	{
 		return matrixStored_[pointer_].matrixVectorProduct(x,y);
 	}
 
+	//! x = a H y + b z in one sweep, returns <y|x>
+	template<typename SomeVectorType>
+	typename SomeVectorType::value_type fusedProduct(SomeVectorType& x,
+	                                                 const SomeVectorType& y,
+	                                                 const SomeVectorType& z,
+	                                                 RealType a,
+	                                                 RealType b,
+	                                                 SizeType threads) const
+	{
+		typedef FusedProduct<SparseMatrixType,SomeVectorType> FusedProductType;
+		return FusedProductType::apply(matrixStored_[pointer_],x,y,z,a,b,threads);
+	}
+
+	//! x += H y for a block of vectors, one column per state
+	void blockProduct(MatrixType& x, const MatrixType& y) const
+	{
+		BlockProduct<ComplexOrRealType>::apply(matrixStored_[pointer_],x,y);
+	}
+
+	void diagonal(VectorRealType& d) const
+	{
+		BlockProduct<ComplexOrRealType>::diagonal(d,matrixStored_[pointer_]);
+	}
+
 private:
 
 	void addTo(WordType& yy,SizeType what,SizeType site) const
@@ -0,0 +1,484 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file SectorArchive.h
+ *
+ *  Binary archive of sectors for dumpmatrix --> thermal.
+ *  File: FileHeader, then one record per sector, appended by each run.
+ *  Record: RecordHeader, eigenvalues, eigenvectors (column major,
+ *          basisSize x states), operator blocks, and at the end the table
+ *          of contents of the operators (OperatorEntry).
+ *  Operator block: the nonzeros as row indices, column indices and values,
+ *          each an array of OperatorEntry::nonzeros elements, ordered by row.
+ *  All offsets are in bytes from the start of the record, and all blocks
+ *  start at multiples of 8 bytes.
+ *  The writer streams blocks and rewrites the record header when done;
+ *  the reader memory-maps the file and hops from record to record to build
+ *  the index, so that any sector or operator is accessed without parsing.
+ *  A record whose header was never rewritten, from a run that did not
+ *  finish, is skipped by the reader and overwritten by the next writer.
+ *
+ */
+#ifndef LANCZOS_SECTOR_ARCHIVE_H
+#define LANCZOS_SECTOR_ARCHIVE_H
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Vector.h"
+#include "Matrix.h"
+#include "CrsMatrix.h"
+#include "TypeToString.h"
+
+namespace LanczosPlusPlus {
+
+struct SectorArchiveFormat {
+
+	enum {NAME_LENGTH = 8};
+
+	static const char* magic() { return "LPPARCH2"; }
+
+	struct FileHeader {
+		char magic[8];
+		uint64_t realSize;
+		uint64_t elementSize;
+	};
+
+	struct RecordHeader {
+		uint64_t bytes; // the whole record, so that the next record is found
+		uint64_t nup;
+		uint64_t ndown;
+		uint64_t basisSize;
+		uint64_t states;
+		uint64_t eigsOffset;
+		uint64_t vecsOffset;
+		uint64_t operators;
+		uint64_t tocOffset;
+	};
+
+	struct OperatorEntry {
+		char name[NAME_LENGTH];
+		uint64_t spin;
+		uint64_t site;
+		int64_t destNup; // -1 if there is no destination sector
+		int64_t destNdown;
+		uint64_t rows;
+		uint64_t cols;
+		uint64_t nonzeros;
+		uint64_t offset;
+	};
+
+	static uint64_t padded(uint64_t bytes)
+	{
+		return (bytes + 7)/8*8;
+	}
+
+	static bool sameName(const char* name, const PsimagLite::String& str)
+	{
+		return (strncmp(name,str.c_str(),NAME_LENGTH) == 0);
+	}
+
+	//! Triplets must be ordered by row; thermal uses it for text dumps too
+	template<typename SparseMatrixType, typename IndexType, typename ValueType>
+	static void fromTriplets(SparseMatrixType& m,
+	                         SizeType rows,
+	                         SizeType cols,
+	                         const IndexType* rowIndex,
+	                         const IndexType* colIndex,
+	                         const ValueType* values,
+	                         SizeType total)
+	{
+		m.resize(rows,cols);
+		SizeType k = 0;
+		for (SizeType i = 0; i < rows; ++i) {
+			m.setRow(i,k);
+			for (; k < total && static_cast<SizeType>(rowIndex[k]) == i; ++k) {
+				m.pushCol(colIndex[k]);
+				m.pushValue(values[k]);
+			}
+		}
+
+		if (k != total) {
+			PsimagLite::String str(__FILE__);
+			str += " " + ttos(__LINE__) + "\n";
+			str += "fromTriplets: triplets not ordered by row\n";
+			throw PsimagLite::RuntimeError(str);
+		}
+
+		m.setRow(rows,k);
+		m.checkValidity();
+	}
+}; // struct SectorArchiveFormat
+
+template<typename ComplexOrRealType>
+class SectorArchiveWriter {
+
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef SectorArchiveFormat::RecordHeader RecordHeaderType;
+	typedef SectorArchiveFormat::OperatorEntry OperatorEntryType;
+	typedef PsimagLite::Vector<OperatorEntryType>::Type VectorOperatorEntryType;
+
+public:
+
+	typedef PsimagLite::Matrix<ComplexOrRealType> MatrixType;
+	typedef PsimagLite::CrsMatrix<ComplexOrRealType> SparseMatrixType;
+
+	SectorArchiveWriter(PsimagLite::String filename)
+	    : filename_(filename),fp_(0),start_(0)
+	{
+		memset(&header_,0,sizeof(header_));
+		FILE* fp = fopen(filename_.c_str(),"ab");
+		if (!fp) error("cannot open");
+		fclose(fp);
+
+		fp_ = fopen(filename_.c_str(),"r+b");
+		if (!fp_) error("cannot open");
+		fseek(fp_,0,SEEK_END);
+		if (ftell(fp_) == 0) {
+			SectorArchiveFormat::FileHeader fileHeader;
+			memcpy(fileHeader.magic,SectorArchiveFormat::magic(),8);
+			fileHeader.realSize = sizeof(RealType);
+			fileHeader.elementSize = sizeof(ComplexOrRealType);
+			write(&fileHeader,sizeof(fileHeader));
+		} else {
+			skipRecords();
+		}
+
+		start_ = ftell(fp_);
+		write(&header_,sizeof(header_));
+	}
+
+	~SectorArchiveWriter()
+	{
+		if (fp_) fclose(fp_);
+	}
+
+	void setSector(SizeType nup, SizeType ndown)
+	{
+		header_.nup = nup;
+		header_.ndown = ndown;
+	}
+
+	void setEigen(const VectorRealType& eigs, const MatrixType& vecs)
+	{
+		assert(vecs.n_col() == eigs.size());
+		header_.states = eigs.size();
+		header_.basisSize = vecs.n_row();
+		header_.eigsOffset = writeBlock((eigs.size() > 0) ? &(eigs[0]) : 0,
+		                                eigs.size()*sizeof(RealType));
+		SizeType total = vecs.n_row()*vecs.n_col();
+		header_.vecsOffset = writeBlock((total > 0) ? &(vecs(0,0)) : 0,
+		                                total*sizeof(ComplexOrRealType));
+	}
+
+	//! destNup < 0 means that the operator has no destination sector
+	void addOperator(PsimagLite::String name,
+	                 SizeType spin,
+	                 SizeType site,
+	                 int destNup,
+	                 int destNdown,
+	                 const SparseMatrixType& matrix)
+	{
+		if (name.length() > SectorArchiveFormat::NAME_LENGTH)
+			error("operator name too long " + name);
+
+		OperatorEntryType entry;
+		memset(&entry,0,sizeof(entry));
+		strncpy(entry.name,name.c_str(),SectorArchiveFormat::NAME_LENGTH);
+		entry.spin = spin;
+		entry.site = site;
+		entry.destNup = destNup;
+		entry.destNdown = destNdown;
+		entry.rows = matrix.row();
+		entry.cols = matrix.col();
+		SizeType total = (entry.rows > 0) ? matrix.getRowPtr(entry.rows) : 0;
+		entry.nonzeros = total;
+
+		PsimagLite::Vector<uint64_t>::Type rowIndex(total);
+		PsimagLite::Vector<uint64_t>::Type colIndex(total);
+		typename PsimagLite::Vector<ComplexOrRealType>::Type values(total);
+		for (SizeType i = 0; i < entry.rows; ++i) {
+			for (int k = matrix.getRowPtr(i); k < matrix.getRowPtr(i+1); ++k) {
+				rowIndex[k] = i;
+				colIndex[k] = matrix.getCol(k);
+				values[k] = matrix.getValue(k);
+			}
+		}
+
+		entry.offset = writeBlock((total > 0) ? &(rowIndex[0]) : 0,
+		                          total*sizeof(uint64_t));
+		writeBlock((total > 0) ? &(colIndex[0]) : 0,total*sizeof(uint64_t));
+		writeBlock((total > 0) ? &(values[0]) : 0,total*sizeof(ComplexOrRealType));
+		toc_.push_back(entry);
+	}
+
+	//! Writes the table of contents and the final record header
+	void close()
+	{
+		if (!fp_) return;
+		header_.operators = toc_.size();
+		header_.tocOffset = writeBlock((toc_.size() > 0) ? &(toc_[0]) : 0,
+		                               toc_.size()*sizeof(OperatorEntryType));
+		header_.bytes = ftell(fp_) - start_;
+		fseek(fp_,start_,SEEK_SET);
+		write(&header_,sizeof(header_));
+		fclose(fp_);
+		fp_ = 0;
+	}
+
+private:
+
+	SectorArchiveWriter(const SectorArchiveWriter&);
+
+	SectorArchiveWriter& operator=(const SectorArchiveWriter&);
+
+	// Checks the file header of an existing archive, and leaves fp_ after
+	// its last complete record; an incomplete record after it is truncated
+	void skipRecords()
+	{
+		long int size = ftell(fp_);
+		SectorArchiveFormat::FileHeader fileHeader;
+		fseek(fp_,0,SEEK_SET);
+		if (fread(&fileHeader,sizeof(fileHeader),1,fp_) != 1 ||
+		        memcmp(fileHeader.magic,SectorArchiveFormat::magic(),8) != 0)
+			error("not a sector archive");
+		if (fileHeader.realSize != sizeof(RealType) ||
+		        fileHeader.elementSize != sizeof(ComplexOrRealType))
+			error("written with a different RealType or ComplexOrRealType");
+
+		long int offset = sizeof(fileHeader);
+		RecordHeaderType h;
+		while (offset < size) {
+			fseek(fp_,offset,SEEK_SET);
+			bool ok = (offset + static_cast<long int>(sizeof(h)) <= size &&
+			           fread(&h,sizeof(h),1,fp_) == 1 &&
+			           h.bytes > 0 &&
+			           offset + static_cast<long int>(h.bytes) <= size);
+			if (!ok) {
+				std::cerr<<"SectorArchiveWriter: dropping incomplete record at ";
+				std::cerr<<offset<<" of "<<filename_<<"\n";
+				fflush(fp_);
+				if (ftruncate(fileno(fp_),offset) != 0) error("cannot truncate");
+				break;
+			}
+
+			offset += h.bytes;
+		}
+
+		fseek(fp_,offset,SEEK_SET);
+	}
+
+	// Returns the offset of the block from the start of the record
+	uint64_t writeBlock(const void* ptr, uint64_t bytes)
+	{
+		uint64_t offset = ftell(fp_) - start_;
+		assert(offset % 8 == 0);
+		write(ptr,bytes);
+		static const char zeros[8] = {0,0,0,0,0,0,0,0};
+		write(zeros,SectorArchiveFormat::padded(bytes) - bytes);
+		return offset;
+	}
+
+	void write(const void* ptr, SizeType bytes)
+	{
+		if (bytes == 0) return;
+		if (fwrite(ptr,1,bytes,fp_) != bytes) error("cannot write");
+	}
+
+	void error(PsimagLite::String msg) const
+	{
+		PsimagLite::String str(__FILE__);
+		str += " " + ttos(__LINE__) + "\n";
+		str += "SectorArchiveWriter: " + msg + " " + filename_ + "\n";
+		throw PsimagLite::RuntimeError(str);
+	}
+
+	PsimagLite::String filename_;
+	FILE* fp_;
+	long int start_;
+	RecordHeaderType header_;
+	VectorOperatorEntryType toc_;
+}; // class SectorArchiveWriter
+
+template<typename ComplexOrRealType>
+class SectorArchive {
+
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef SectorArchiveFormat::RecordHeader RecordHeaderType;
+	typedef SectorArchiveFormat::OperatorEntry OperatorEntryType;
+
+public:
+
+	typedef PsimagLite::CrsMatrix<ComplexOrRealType> SparseMatrixType;
+
+	SectorArchive(PsimagLite::String filename)
+	    : filename_(filename),fd_(-1),data_(0),bytes_(0)
+	{
+		fd_ = open(filename_.c_str(),O_RDONLY);
+		if (fd_ < 0) error("cannot open");
+
+		struct stat info;
+		if (fstat(fd_,&info) != 0) error("cannot stat");
+		bytes_ = info.st_size;
+		if (bytes_ < sizeof(SectorArchiveFormat::FileHeader)) error("too small");
+
+		void* ptr = mmap(0,bytes_,PROT_READ,MAP_SHARED,fd_,0);
+		if (ptr == MAP_FAILED) error("cannot mmap");
+		data_ = static_cast<const char*>(ptr);
+
+		const SectorArchiveFormat::FileHeader* fileHeader =
+		        reinterpret_cast<const SectorArchiveFormat::FileHeader*>(data_);
+		if (memcmp(fileHeader->magic,SectorArchiveFormat::magic(),8) != 0)
+			error("not a sector archive");
+		if (fileHeader->realSize != sizeof(RealType) ||
+		        fileHeader->elementSize != sizeof(ComplexOrRealType))
+			error("written with a different RealType or ComplexOrRealType");
+
+		// an incomplete last record is from a run that did not finish
+		uint64_t offset = sizeof(SectorArchiveFormat::FileHeader);
+		while (offset < bytes_) {
+			bool ok = (offset + sizeof(RecordHeaderType) <= bytes_);
+			const RecordHeaderType* h = (ok) ? &header(offset) : 0;
+			if (!ok || h->bytes == 0 || offset + h->bytes > bytes_) {
+				std::cerr<<"SectorArchive: WARNING: ignoring incomplete record at ";
+				std::cerr<<offset<<" of "<<filename_<<"\n";
+				break;
+			}
+
+			records_.push_back(offset);
+			offset += h->bytes;
+		}
+	}
+
+	~SectorArchive()
+	{
+		if (data_) munmap(const_cast<char*>(data_),bytes_);
+		if (fd_ >= 0) ::close(fd_);
+	}
+
+	static bool isArchive(PsimagLite::String filename)
+	{
+		FILE* fp = fopen(filename.c_str(),"rb");
+		if (!fp) return false;
+		char magic[8];
+		bool b = (fread(magic,1,8,fp) == 8 &&
+		          memcmp(magic,SectorArchiveFormat::magic(),8) == 0);
+		fclose(fp);
+		return b;
+	}
+
+	SizeType sectors() const { return records_.size(); }
+
+	SizeType nup(SizeType ind) const { return header(records_[ind]).nup; }
+
+	SizeType ndown(SizeType ind) const { return header(records_[ind]).ndown; }
+
+	SizeType states(SizeType ind) const { return header(records_[ind]).states; }
+
+	SizeType basisSize(SizeType ind) const { return header(records_[ind]).basisSize; }
+
+	const RealType* eigenvalues(SizeType ind) const
+	{
+		return reinterpret_cast<const RealType*>(block(ind,
+		                                               header(records_[ind]).eigsOffset));
+	}
+
+	//! basisSize(ind) x states(ind), column major
+	const ComplexOrRealType* eigenvectors(SizeType ind) const
+	{
+		const RecordHeaderType& h = header(records_[ind]);
+		return reinterpret_cast<const ComplexOrRealType*>(block(ind,h.vecsOffset));
+	}
+
+	//! Returns false if sector ind has no such operator or it has no destination
+	bool getOperator(SparseMatrixType& m,
+	                 int& destNup,
+	                 int& destNdown,
+	                 SizeType ind,
+	                 PsimagLite::String name,
+	                 SizeType spin,
+	                 SizeType site) const
+	{
+		const RecordHeaderType& h = header(records_[ind]);
+		const OperatorEntryType* toc =
+		        reinterpret_cast<const OperatorEntryType*>(block(ind,h.tocOffset));
+		for (SizeType i = 0; i < h.operators; ++i) {
+			const OperatorEntryType& entry = toc[i];
+			if (!SectorArchiveFormat::sameName(entry.name,name)) continue;
+			if (entry.spin != spin || entry.site != site) continue;
+			destNup = entry.destNup;
+			destNdown = entry.destNdown;
+			if (destNup < 0 || entry.rows == 0 || entry.cols == 0) return false;
+			SizeType total = entry.nonzeros;
+			const char* ptr = block(ind,entry.offset);
+			const uint64_t* rowIndex = reinterpret_cast<const uint64_t*>(ptr);
+			const uint64_t* colIndex = rowIndex + total;
+			const ComplexOrRealType* values =
+			        reinterpret_cast<const ComplexOrRealType*>(colIndex + total);
+			SectorArchiveFormat::fromTriplets(m,
+			                                  entry.rows,
+			                                  entry.cols,
+			                                  rowIndex,
+			                                  colIndex,
+			                                  values,
+			                                  total);
+			return true;
+		}
+
+		return false;
+	}
+
+private:
+
+	SectorArchive(const SectorArchive&);
+
+	SectorArchive& operator=(const SectorArchive&);
+
+	const RecordHeaderType& header(uint64_t offset) const
+	{
+		return *reinterpret_cast<const RecordHeaderType*>(data_ + offset);
+	}
+
+	const char* block(SizeType ind, uint64_t offset) const
+	{
+		return data_ + records_[ind] + offset;
+	}
+
+	void error(PsimagLite::String msg) const
+	{
+		PsimagLite::String str(__FILE__);
+		str += " " + ttos(__LINE__) + "\n";
+		str += "SectorArchive: " + msg + " " + filename_ + "\n";
+		throw PsimagLite::RuntimeError(str);
+	}
+
+	PsimagLite::String filename_;
+	int fd_;
+	const char* data_;
+	SizeType bytes_;
+	PsimagLite::Vector<uint64_t>::Type records_;
+}; // class SectorArchive
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_SECTOR_ARCHIVE_H
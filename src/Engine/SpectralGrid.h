@@ -0,0 +1,245 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file SpectralGrid.h
+ *
+ *  Continued fractions of spectral functions evaluated on a frequency grid,
+ *  in process. Each fraction is stored as its poles, from the eigenpairs
+ *  (E_l, U) of its tridiagonal matrix: G(z) = weight sum_l |U_{0,l}|^2/
+ *  (z - isign*(E_l - Eg)), as PsimagLite's ContinuedFraction has it.
+ *  Fractions with the same orbitals are added.
+ *
+ */
+#ifndef LANCZOS_SPECTRAL_GRID_H
+#define LANCZOS_SPECTRAL_GRID_H
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include "Vector.h"
+#include "Matrix.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+#include "TypeToString.h"
+
+namespace LanczosPlusPlus {
+
+template<typename RealType>
+struct SpectralGridParams {
+
+	enum FreqEnum {FREQ_REAL, FREQ_MATSUBARA};
+
+	SpectralGridParams()
+	    : freqType(FREQ_REAL),begin(0),end(0),step(0),delta(0),beta(0),total(0)
+	{}
+
+	//! Real frequencies from begin to end, z = omega + i delta
+	SpectralGridParams(RealType begin_,RealType end_,RealType step_,RealType delta_)
+	    : freqType(FREQ_REAL),
+	      begin(begin_),
+	      end(end_),
+	      step(step_),
+	      delta(delta_),
+	      beta(0),
+	      total((step_ > 0 && end_ >= begin_) ?
+	                static_cast<SizeType>((end_ - begin_)/step_) + 1 : 0)
+	{}
+
+	//! The first total Matsubara frequencies at inverse temperature beta
+	SpectralGridParams(RealType beta_,SizeType total_)
+	    : freqType(FREQ_MATSUBARA),
+	      begin(0),
+	      end(0),
+	      step(0),
+	      delta(0),
+	      beta(beta_),
+	      total(total_)
+	{}
+
+	bool enabled() const { return (total > 0); }
+
+	FreqEnum freqType;
+	RealType begin;
+	RealType end;
+	RealType step;
+	RealType delta;
+	RealType beta;
+	SizeType total;
+}; // struct SpectralGridParams
+
+template<typename RealType>
+class SpectralGrid {
+
+	typedef std::complex<RealType> ComplexType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Matrix<RealType> MatrixRealType;
+	typedef PsimagLite::Matrix<ComplexType> MatrixComplexType;
+	typedef std::pair<SizeType,SizeType> PairType;
+
+	// One task per frequency and fraction
+	class Tasks {
+
+	public:
+
+		Tasks(const SpectralGrid& grid, MatrixComplexType& values)
+		    : grid_(grid),values_(values)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			SizeType nfreq = values_.n_row();
+			for (SizeType p = 0; p < blockSize; ++p) {
+				SizeType taskNumber = threadNum*blockSize + p;
+				if (taskNumber >= total) break;
+				SizeType i = taskNumber % nfreq;
+				SizeType f = taskNumber/nfreq;
+				values_(i,f) = grid_.fraction(grid_.z(i),f);
+			}
+		}
+
+	private:
+
+		const SpectralGrid& grid_;
+		MatrixComplexType& values_;
+	}; // class Tasks
+
+public:
+
+	typedef SpectralGridParams<RealType> ParamsType;
+
+	SpectralGrid(const ParamsType& params, bool fermionic)
+	    : params_(params),fermionic_(fermionic)
+	{}
+
+	const ParamsType& params() const { return params_; }
+
+	//! Same arguments as ContinuedFraction::set, but reorthogonalization
+	template<typename TridiagonalMatrixType>
+	void push(const TridiagonalMatrixType& ab,
+	          RealType gsEnergy,
+	          RealType weight,
+	          int isign,
+	          const PairType& orbs)
+	{
+		MatrixRealType t;
+		ab.buildDenseMatrix(t);
+		VectorRealType eigs(t.n_row());
+		if (t.n_row() > 0) diag(t,eigs,'V');
+
+		VectorRealType poles(eigs.size());
+		VectorRealType weights(eigs.size());
+		for (SizeType l = 0; l < eigs.size(); ++l) {
+			poles[l] = isign*(eigs[l] - gsEnergy);
+			weights[l] = weight*t(0,l)*t(0,l);
+		}
+
+		poles_.push_back(poles);
+		weights_.push_back(weights);
+		orbs_.push_back(orbs);
+	}
+
+	ComplexType z(SizeType i) const
+	{
+		if (params_.freqType == ParamsType::FREQ_REAL)
+			return ComplexType(params_.begin + i*params_.step,params_.delta);
+
+		RealType n = (fermionic_) ? 2*i + 1 : 2*i;
+		return ComplexType(0,n*M_PI/params_.beta);
+	}
+
+	ComplexType fraction(ComplexType z, SizeType f) const
+	{
+		const VectorRealType& poles = poles_[f];
+		const VectorRealType& weights = weights_[f];
+		ComplexType sum = 0;
+		for (SizeType l = 0; l < poles.size(); ++l)
+			sum += weights[l]/(z - poles[l]);
+		return sum;
+	}
+
+	/* PSIDOC SpectralGrid
+	With -w or -m, the continued fractions of -g are also evaluated on a frequency
+	grid, in parallel with Threads= threads. Output is one block per pair of sites,
+	\begin{verbatim}
+	#SpectralGrid i j
+	#Columns omega orb1,orb2 ...
+	\end{verbatim}
+	and then one line per frequency with $\omega$ (or $\omega_n$ for Matsubara)
+	followed by the imaginary and real parts of $G_{ij}(z)$ for each pair of
+	orbitals, which adds all spins and all fractions of that pair.
+	*/
+	void print(std::ostream& os, SizeType isite, SizeType jsite) const
+	{
+		print(os,ttos(isite) + " " + ttos(jsite));
+	}
+
+	void print(std::ostream& os, PsimagLite::String label) const
+	{
+		typedef PsimagLite::Parallelizer<Tasks> ParallelizerType;
+
+		SizeType nfreq = params_.total;
+		SizeType nfractions = poles_.size();
+		MatrixComplexType values(nfreq,nfractions);
+		Tasks tasks(*this,values);
+		ParallelizerType threaded(PsimagLite::Concurrency::npthreads,
+		                          PsimagLite::MPI::COMM_WORLD);
+		threaded.loopCreate(nfreq*nfractions,tasks);
+
+		typename PsimagLite::Vector<PairType>::Type pairs;
+		PsimagLite::Vector<SizeType>::Type column(nfractions,0);
+		for (SizeType f = 0; f < nfractions; ++f) {
+			SizeType c = 0;
+			for (; c < pairs.size(); ++c)
+				if (pairs[c] == orbs_[f]) break;
+			if (c == pairs.size()) pairs.push_back(orbs_[f]);
+			column[f] = c;
+		}
+
+		os<<"#SpectralGrid "<<label<<"\n";
+		os<<"#Columns omega";
+		for (SizeType c = 0; c < pairs.size(); ++c)
+			os<<" "<<pairs[c].first<<","<<pairs[c].second;
+		os<<"\n";
+
+		typename PsimagLite::Vector<ComplexType>::Type sums(pairs.size());
+		for (SizeType i = 0; i < nfreq; ++i) {
+			std::fill(sums.begin(),sums.end(),ComplexType(0));
+			for (SizeType f = 0; f < nfractions; ++f)
+				sums[column[f]] += values(i,f);
+
+			ComplexType zi = z(i);
+			os<<((params_.freqType == ParamsType::FREQ_REAL) ? std::real(zi) : std::imag(zi));
+			for (SizeType c = 0; c < sums.size(); ++c)
+				os<<" "<<std::imag(sums[c])<<" "<<std::real(sums[c]);
+			os<<"\n";
+		}
+	}
+
+private:
+
+	ParamsType params_;
+	bool fermionic_;
+	typename PsimagLite::Vector<VectorRealType>::Type poles_;
+	typename PsimagLite::Vector<VectorRealType>::Type weights_;
+	typename PsimagLite::Vector<PairType>::Type orbs_;
+}; // class SpectralGrid
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_SPECTRAL_GRID_H
@@ -0,0 +1,474 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file ThermalPureQuantum.h
+ *
+ *  Thermal pure quantum (TPQ) states for one sector.
+ *  Canonical: |beta> = exp(-beta H/2)|r>, with |r> random, so that
+ *  Z(beta) ~ <beta|beta> and <A>(beta) = <beta|A|beta>/<beta|beta>;
+ *  the propagation is done with KrylovEvolution in imaginary time.
+ *  Microcanonical: |k> ~ (l - H/N)^k |r>, with inverse temperature
+ *  beta_k = 2k/(N(l - u_k)), where u_k = <k|H|k>/N and N is the number of sites;
+ *  l*N must be above the spectrum, which is checked with a short Lanczos chain.
+ *  Each sample is independent, so samples are done in parallel.
+ *
+ */
+#ifndef LANCZOS_THERMAL_PURE_QUANTUM_H
+#define LANCZOS_THERMAL_PURE_QUANTUM_H
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include "Vector.h"
+#include "Matrix.h"
+#include "Random48.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+#include "ProgressIndicator.h"
+#include "ProgramGlobals.h"
+#include "KrylovEvolution.h"
+#include "FiniteTemperatureLanczos.h"
+#include "TypeToString.h"
+
+namespace LanczosPlusPlus {
+
+template<typename RealType>
+struct TpqParams {
+
+	enum EnsembleEnum {CANONICAL, MICROCANONICAL};
+
+	TpqParams()
+	    : ensemble(CANONICAL),
+	      samples(10),
+	      steps(100),
+	      seed(1234),
+	      betaStep(0.1),
+	      l(1.0),
+	      krylovSteps(20),
+	      tolerance(1e-10),
+	      operatorName(""),
+	      site(0)
+	{}
+
+	EnsembleEnum ensemble;
+	SizeType samples;
+	SizeType steps;
+	long int seed;
+	RealType betaStep;
+	RealType l;
+	SizeType krylovSteps;
+	RealType tolerance;
+	PsimagLite::String operatorName;
+	SizeType site;
+}; // struct TpqParams
+
+// One temperature point of one sample
+template<typename RealType>
+struct TpqPoint {
+
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+	TpqPoint() : beta(0),logNorm2(0),energy(0),energy2(0) {}
+
+	RealType beta;
+	RealType logNorm2; // log <psi|psi> before normalization, canonical only
+	RealType energy; // <H>
+	RealType energy2; // <H^2>
+	VectorRealType observables;
+}; // struct TpqPoint
+
+template<typename ModelType, typename InternalProductType>
+class TpqSampling {
+
+	typedef typename ModelType::RealType RealType;
+	typedef typename ModelType::ComplexOrRealType ComplexOrRealType;
+	typedef typename ModelType::BasisBaseType BasisType;
+	typedef KrylovEvolution<InternalProductType> KrylovEvolutionType;
+	typedef typename KrylovEvolutionType::VectorComplexType VectorComplexType;
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Random48<RealType> RandomType;
+	typedef TpqParams<RealType> TpqParamsType;
+	typedef TpqPoint<RealType> TpqPointType;
+	typedef FtlmSampling<ModelType,InternalProductType> FtlmSamplingType;
+
+public:
+
+	typedef typename PsimagLite::Vector<TpqPointType>::Type VectorTpqPointType;
+	typedef typename PsimagLite::Vector<VectorTpqPointType>::Type VectorVectorTpqPointType;
+
+	TpqSampling(VectorVectorTpqPointType& results,
+	            const ModelType& model,
+	            const BasisType& basis,
+	            const InternalProductType& matrix,
+	            const TpqParamsType& params)
+	    : results_(results),
+	      model_(model),
+	      basis_(basis),
+	      matrix_(matrix),
+	      params_(params),
+	      nsites_(model.geometry().numberOfSites())
+	{}
+
+	void thread_function_(SizeType threadNum,
+	                      SizeType blockSize,
+	                      SizeType total,
+	                      PsimagLite::Concurrency::MutexType*)
+	{
+		for (SizeType p = 0; p < blockSize; ++p) {
+			SizeType taskNumber = threadNum*blockSize + p;
+			if (taskNumber >= total) break;
+			if (params_.ensemble == TpqParamsType::CANONICAL)
+				doCanonical(results_[taskNumber],taskNumber);
+			else
+				doMicrocanonical(results_[taskNumber],taskNumber);
+		}
+	}
+
+	template<typename SomeVectorType>
+	static RealType norm2(const SomeVectorType& v)
+	{
+		RealType sum = 0;
+		for (SizeType i = 0; i < v.size(); ++i)
+			sum += PsimagLite::real(PsimagLite::conj(v[i])*v[i]);
+		return sum;
+	}
+
+private:
+
+	// Entries are +-1 so that <r|r> is the dimension and <r|exp(-beta H)|r> ~ Z
+	template<typename SomeVectorType>
+	void randomVector(SomeVectorType& r, SizeType sampleIndex) const
+	{
+		RandomType rng(params_.seed + sampleIndex);
+		for (SizeType i = 0; i < r.size(); ++i)
+			r[i] = (rng() < 0.5) ? -1.0 : 1.0;
+	}
+
+	void doCanonical(VectorTpqPointType& points, SizeType sampleIndex) const
+	{
+		SizeType n = basis_.size();
+		VectorComplexType psi(n);
+		VectorComplexType w(n);
+		randomVector(psi,sampleIndex);
+
+		KrylovEvolutionType krylov(matrix_,params_.krylovSteps,params_.tolerance);
+		RealType logNorm2 = 0;
+		points.resize(params_.steps + 1);
+		for (SizeType k = 0; k <= params_.steps; ++k) {
+			RealType nrm = KrylovEvolutionType::norm(psi);
+			logNorm2 += 2.0*log(nrm);
+			for (SizeType i = 0; i < n; ++i)
+				psi[i] /= nrm;
+
+			TpqPointType& point = points[k];
+			point.beta = k*params_.betaStep;
+			point.logNorm2 = logNorm2;
+			std::fill(w.begin(),w.end(),0.0);
+			krylov.matrixVectorProduct(w,psi);
+			measure(point,psi,w);
+
+			if (k == params_.steps) break;
+			krylov.evolve(psi,0.5*params_.betaStep,KrylovEvolutionType::IMAGINARY_TIME);
+		}
+	}
+
+	void doMicrocanonical(VectorTpqPointType& points, SizeType sampleIndex) const
+	{
+		SizeType n = basis_.size();
+		VectorType psi(n);
+		VectorType w(n);
+		randomVector(psi,sampleIndex);
+		RealType lN = params_.l*nsites_;
+
+		points.resize(params_.steps + 1);
+		for (SizeType k = 0; k <= params_.steps; ++k) {
+			RealType nrm = sqrt(norm2(psi));
+			for (SizeType i = 0; i < n; ++i)
+				psi[i] /= nrm;
+
+			TpqPointType& point = points[k];
+			std::fill(w.begin(),w.end(),ComplexOrRealType(0));
+			matrix_.matrixVectorProduct(w,psi);
+			measure(point,psi,w);
+
+			RealType u = point.energy/nsites_;
+			if (params_.l <= u) {
+				PsimagLite::String str(__FILE__);
+				str += " " + ttos(__LINE__) + "\n";
+				str += "TPQ: l=" + ttos(params_.l) + " must be larger than the energy ";
+				str += "per site " + ttos(u) + "\n";
+				throw PsimagLite::RuntimeError(str);
+			}
+
+			point.beta = 2.0*k/(nsites_*(params_.l - u));
+
+			if (k == params_.steps) break;
+			// psi = (lN - H)psi, w holds H psi already
+			for (SizeType i = 0; i < n; ++i)
+				psi[i] = lN*psi[i] - w[i];
+		}
+	}
+
+	// psi is normalized and w is H psi
+	template<typename SomeVectorType>
+	void measure(TpqPointType& point,
+	             const SomeVectorType& psi,
+	             const SomeVectorType& w) const
+	{
+		point.energy = 0;
+		for (SizeType i = 0; i < psi.size(); ++i)
+			point.energy += PsimagLite::real(PsimagLite::conj(psi[i])*w[i]);
+		point.energy2 = norm2(w);
+
+		SizeType nsites = (params_.operatorName == "") ? 0 : nsites_;
+		point.observables.resize(nsites);
+		std::fill(point.observables.begin(),point.observables.end(),0.0);
+		VectorRealType a(nsites);
+		for (SizeType x = 0; x < psi.size() && nsites > 0; ++x) {
+			RealType p = PsimagLite::real(PsimagLite::conj(psi[x])*psi[x]);
+			if (p == 0) continue;
+			FtlmSamplingType::diagonalObservables(a,
+			                                      model_,
+			                                      basis_,
+			                                      x,
+			                                      params_.operatorName,
+			                                      params_.site);
+			for (SizeType site = 0; site < nsites; ++site)
+				point.observables[site] += p*a[site];
+		}
+	}
+
+	VectorVectorTpqPointType& results_;
+	const ModelType& model_;
+	const BasisType& basis_;
+	const InternalProductType& matrix_;
+	const TpqParamsType& params_;
+	SizeType nsites_;
+}; // class TpqSampling
+
+template<typename ModelType, typename InternalProductType>
+class ThermalPureQuantum {
+
+	typedef typename ModelType::RealType RealType;
+	typedef typename ModelType::ComplexOrRealType ComplexOrRealType;
+	typedef typename ModelType::BasisBaseType BasisType;
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+	typedef PsimagLite::Matrix<RealType> MatrixRealType;
+	typedef PsimagLite::Random48<RealType> RandomType;
+	typedef TpqSampling<ModelType,InternalProductType> TpqSamplingType;
+	typedef typename TpqSamplingType::VectorVectorTpqPointType VectorVectorTpqPointType;
+	typedef PsimagLite::Parallelizer<TpqSamplingType> ParallelizerType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+public:
+
+	typedef TpqParams<RealType> TpqParamsType;
+
+	ThermalPureQuantum(const ModelType& model,
+	                   const BasisType& basis,
+	                   const InternalProductType& matrix,
+	                   const TpqParamsType& params)
+	    : model_(model),
+	      params_(params),
+	      progress_("ThermalPureQuantum"),
+	      results_(params.samples)
+	{
+		if (params_.operatorName != "" &&
+		        params_.operatorName != "n" &&
+		        params_.operatorName != "sz") {
+			PsimagLite::String str(__FILE__);
+			str += " " + ttos(__LINE__) + "\n";
+			str += "TPQ: unsupported operator " + params_.operatorName + "\n";
+			throw PsimagLite::RuntimeError(str);
+		}
+
+		if (params_.site >= model_.geometry().numberOfSites())
+			throw PsimagLite::RuntimeError("TPQ: site too big\n");
+
+		if (params_.ensemble == TpqParamsType::MICROCANONICAL)
+			checkLargestEnergy(matrix,basis.size());
+
+		TpqSamplingType helper(results_,model,basis,matrix,params_);
+		ParallelizerType threaded(PsimagLite::Concurrency::npthreads,
+		                          PsimagLite::MPI::COMM_WORLD);
+		threaded.loopCreate(params_.samples,helper);
+
+		PsimagLite::OstringStream msg;
+		msg<<"Sampled "<<params_.samples<<" random vectors of size "<<basis.size();
+		progress_.printline(msg,std::cerr);
+	}
+
+	void print(std::ostream& os) const
+	{
+		SizeType nsites = (params_.operatorName == "") ? 0 :
+		                                                 model_.geometry().numberOfSites();
+		bool canonical = (params_.ensemble == TpqParamsType::CANONICAL);
+		os<<"#beta "<<((canonical) ? "lnZ " : "")<<"energy specificHeat";
+		if (nsites > 0) {
+			os<<" <"<<params_.operatorName<<"_"<<params_.site<<" "<<params_.operatorName;
+			os<<"_j> for j=0.."<<(nsites - 1);
+		}
+
+		os<<"\n";
+
+		for (SizeType k = 0; k <= params_.steps; ++k) {
+			if (canonical)
+				printCanonical(os,k,nsites);
+			else
+				printMicrocanonical(os,k,nsites);
+		}
+	}
+
+private:
+
+	enum {BOUND_STEPS = 30};
+
+	// (l - H/N)^k only filters towards the lowest states if l*N is above the
+	// whole spectrum, so l is checked against an estimate of the largest
+	// eigenvalue before any power iteration: the largest Ritz value of a
+	// short Lanczos chain plus the norm of its residual
+	void checkLargestEnergy(const InternalProductType& matrix, SizeType n) const
+	{
+		SizeType nsites = model_.geometry().numberOfSites();
+		RealType eMax = largestEnergyBound(matrix,n);
+		if (params_.l*nsites > eMax) return;
+
+		PsimagLite::String str(__FILE__);
+		str += " " + ttos(__LINE__) + "\n";
+		str += "TPQ: l=" + ttos(params_.l) + " must be larger than the largest ";
+		str += "energy per site, estimated at " + ttos(eMax/nsites) + "\n";
+		throw PsimagLite::RuntimeError(str);
+	}
+
+	RealType largestEnergyBound(const InternalProductType& matrix, SizeType n) const
+	{
+		SizeType steps = std::min(n,static_cast<SizeType>(BOUND_STEPS));
+		RandomType rng(params_.seed);
+		VectorType v(n);
+		VectorType vPrev(n,0);
+		VectorType w(n);
+		for (SizeType i = 0; i < n; ++i)
+			v[i] = rng() - 0.5;
+		RealType nrm = sqrt(TpqSamplingType::norm2(v));
+		for (SizeType i = 0; i < n; ++i)
+			v[i] /= nrm;
+
+		VectorRealType alpha;
+		VectorRealType beta;
+		RealType b = 0;
+		for (SizeType k = 0; k < steps; ++k) {
+			std::fill(w.begin(),w.end(),ComplexOrRealType(0));
+			matrix.matrixVectorProduct(w,v);
+			ComplexOrRealType tmp = 0;
+			for (SizeType i = 0; i < n; ++i)
+				tmp += PsimagLite::conj(v[i])*w[i];
+			RealType a = PsimagLite::real(tmp);
+			alpha.push_back(a);
+			for (SizeType i = 0; i < n; ++i)
+				w[i] -= a*v[i] + b*vPrev[i];
+			b = sqrt(TpqSamplingType::norm2(w));
+			beta.push_back(b);
+			if (b < 1e-12) break;
+			vPrev = v;
+			for (SizeType i = 0; i < n; ++i)
+				v[i] = w[i]/b;
+		}
+
+		SizeType m = alpha.size();
+		MatrixRealType t(m,m);
+		for (SizeType i = 0; i < m; ++i) {
+			t(i,i) = alpha[i];
+			if (i + 1 < m) t(i,i+1) = t(i+1,i) = beta[i];
+		}
+
+		VectorRealType eigs(m);
+		diag(t,eigs,'V');
+		// eigenvalues are in increasing order
+		return eigs[m-1] + fabs(beta[m-1]*t(m-1,m-1));
+	}
+
+	// Samples are weighted by their norms <beta|beta>
+	void printCanonical(std::ostream& os, SizeType k, SizeType nsites) const
+	{
+		SizeType samples = results_.size();
+		RealType shift = -1e300;
+		for (SizeType r = 0; r < samples; ++r)
+			shift = std::max(shift,results_[r][k].logNorm2);
+
+		RealType z = 0;
+		RealType energy = 0;
+		RealType energy2 = 0;
+		VectorRealType observables(nsites,0);
+		for (SizeType r = 0; r < samples; ++r) {
+			const TpqPoint<RealType>& point = results_[r][k];
+			RealType w = exp(point.logNorm2 - shift);
+			z += w;
+			energy += w*point.energy;
+			energy2 += w*point.energy2;
+			for (SizeType site = 0; site < nsites; ++site)
+				observables[site] += w*point.observables[site];
+		}
+
+		RealType beta = results_[0][k].beta;
+		energy /= z;
+		energy2 /= z;
+		os<<beta<<" "<<(log(z/samples) + shift)<<" "<<energy<<" ";
+		os<<(beta*beta*(energy2 - energy*energy));
+		for (SizeType site = 0; site < nsites; ++site)
+			os<<" "<<(observables[site]/z);
+		os<<"\n";
+	}
+
+	// Energies are averaged first, and beta follows from the average
+	void printMicrocanonical(std::ostream& os, SizeType k, SizeType nsites) const
+	{
+		SizeType samples = results_.size();
+		RealType energy = 0;
+		RealType energy2 = 0;
+		VectorRealType observables(nsites,0);
+		for (SizeType r = 0; r < samples; ++r) {
+			const TpqPoint<RealType>& point = results_[r][k];
+			energy += point.energy;
+			energy2 += point.energy2;
+			for (SizeType site = 0; site < nsites; ++site)
+				observables[site] += point.observables[site];
+		}
+
+		energy /= samples;
+		energy2 /= samples;
+		RealType n = model_.geometry().numberOfSites();
+		RealType beta = 2.0*k/(n*(params_.l - energy/n));
+		// The weight (l - E/N)^{2k} of |k> narrows its energy distribution:
+		// its log has the extra curvature beta^2/(2k), so the canonical
+		// specific heat is x/(1 - x/(2k)) with x = beta^2 sigma^2
+		RealType x = beta*beta*(energy2 - energy*energy);
+		RealType specificHeat = (k == 0) ? 0 : x/(1.0 - x/(2.0*k));
+		os<<beta<<" "<<energy<<" "<<specificHeat;
+		for (SizeType site = 0; site < nsites; ++site)
+			os<<" "<<(observables[site]/samples);
+		os<<"\n";
+	}
+
+	const ModelType& model_;
+	const TpqParamsType& params_;
+	PsimagLite::ProgressIndicator progress_;
+	VectorVectorTpqPointType results_;
+}; // class ThermalPureQuantum
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_THERMAL_PURE_QUANTUM_H
@@ -0,0 +1,328 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file ThickRestartLanczos.h
+ *
+ *  The k lowest eigenpairs by thick-restart Lanczos. The Krylov basis
+ *  grows up to m vectors, kept orthogonal, and T = V^dagger H V. Then the
+ *  lowest Ritz vectors are kept, together with the last Lanczos vector,
+ *  and T becomes diagonal plus one row and column with the couplings
+ *  beta y_{m-1,i}, which are also the residual norms of the Ritz pairs.
+ *
+ */
+#ifndef LANCZOS_THICK_RESTART_LANCZOS_H
+#define LANCZOS_THICK_RESTART_LANCZOS_H
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include "Vector.h"
+#include "Matrix.h"
+#include "Random48.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+
+namespace LanczosPlusPlus {
+
+/* PSIDOC ThickRestartLanczos
+With SolverOptions=ThickRestartLanczos the ground state of each sector is
+computed by thick-restart Lanczos, in bounded memory, with these labels:
+\begin{itemize}
+\item[ThickRestartBasis=] Largest number of Krylov vectors, 40 by default.
+Memory is this number plus one times the size of the sector.
+\item[ThickRestartStates=] Number of lowest eigenpairs that must converge,
+1 by default. Use more for nearly degenerate sectors.
+\item[ThickRestartTolerance=] Largest residual norm $|H\psi-E\psi|$ of a
+converged eigenpair, relative to $|E|$ when $|E|>1$; $10^{-8}$ by default.
+\item[ThickRestartMaxRestarts=] 100 by default.
+\end{itemize}
+*/
+template<typename RealType>
+struct ThickRestartParams {
+
+	ThickRestartParams() : basis(40),states(1),tolerance(1e-8),maxRestarts(100)
+	{}
+
+	template<typename InputType>
+	ThickRestartParams(InputType& io)
+	    : basis(40),states(1),tolerance(1e-8),maxRestarts(100)
+	{
+		try {
+			io.readline(basis,"ThickRestartBasis=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(states,"ThickRestartStates=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(tolerance,"ThickRestartTolerance=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(maxRestarts,"ThickRestartMaxRestarts=");
+		} catch (std::exception&) {}
+
+		if (states == 0) states = 1;
+	}
+
+	SizeType basis;
+	SizeType states;
+	RealType tolerance;
+	SizeType maxRestarts;
+}; // struct ThickRestartParams
+
+template<typename MatrixType, typename ComplexOrRealType>
+class ThickRestartLanczos {
+
+	typedef typename PsimagLite::Real<ComplexOrRealType>::Type RealType;
+	typedef typename PsimagLite::Vector<ComplexOrRealType>::Type VectorType;
+	typedef typename PsimagLite::Vector<VectorType>::Type VectorVectorType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef PsimagLite::Matrix<RealType> MatrixRealType;
+	typedef PsimagLite::Random48<RealType> RandomType;
+
+	// The first keep vectors become V Y, in place; one task per element,
+	// because element i of the new vectors needs only element i of the old
+	class RotateTasks {
+
+	public:
+
+		RotateTasks(VectorVectorType& basis,
+		            const MatrixRealType& y,
+		            SizeType mEff,
+		            SizeType keep)
+		    : basis_(basis),y_(y),mEff_(mEff),keep_(keep)
+		{}
+
+		void thread_function_(SizeType threadNum,
+		                      SizeType blockSize,
+		                      SizeType total,
+		                      PsimagLite::Concurrency::MutexType*)
+		{
+			SizeType start = threadNum*blockSize;
+			SizeType end = std::min<SizeType>(start + blockSize,total);
+			VectorType tmp(keep_);
+			for (SizeType i = start; i < end; ++i) {
+				for (SizeType c = 0; c < keep_; ++c) {
+					ComplexOrRealType sum = 0;
+					for (SizeType l = 0; l < mEff_; ++l)
+						sum += basis_[l][i]*y_(l,c);
+					tmp[c] = sum;
+				}
+
+				for (SizeType c = 0; c < keep_; ++c)
+					basis_[c][i] = tmp[c];
+			}
+		}
+
+	private:
+
+		VectorVectorType& basis_;
+		const MatrixRealType& y_;
+		SizeType mEff_;
+		SizeType keep_;
+	}; // class RotateTasks
+
+public:
+
+	typedef PsimagLite::Matrix<ComplexOrRealType> DenseMatrixType;
+	typedef ThickRestartParams<RealType> ParamsType;
+
+	ThickRestartLanczos(const MatrixType& matrix, const ParamsType& params)
+	    : matrix_(matrix),n_(matrix.rank()),params_(params),restarts_(0)
+	{}
+
+	//! Lowest eigenpair, after ThickRestartStates= of them have converged
+	void computeGroundState(RealType& energy, VectorType& z)
+	{
+		VectorRealType eigs;
+		DenseMatrixType vecs;
+		lowest(eigs,vecs,params_.states);
+		energy = eigs[0];
+		z.resize(n_);
+		for (SizeType i = 0; i < n_; ++i)
+			z[i] = vecs(i,0);
+
+		std::cout<<"ThickRestartLanczos: "<<restarts_<<" restarts, energies=";
+		for (SizeType c = 0; c < eigs.size(); ++c)
+			std::cout<<" "<<eigs[c];
+		std::cout<<"\n";
+	}
+
+	//! eigenvectors are the columns of vecs, like diag(...,'V') does
+	void lowest(VectorRealType& eigs, DenseMatrixType& vecs, SizeType k)
+	{
+		k = std::min(k,n_);
+		SizeType m = std::min(std::max(params_.basis,k + 2),n_);
+		VectorVectorType basis(m + 1,VectorType(n_,0));
+		RandomType rng(1234);
+		for (SizeType i = 0; i < n_; ++i)
+			basis[0][i] = rng() - 0.5;
+		scale(basis[0],1.0/norm(basis[0]));
+
+		MatrixRealType t(m,m);
+		MatrixRealType y;
+		VectorRealType theta;
+		SizeType kept = 0;
+		SizeType mEff = m;
+		RealType beta = 0;
+		for (restarts_ = 0; ; ++restarts_) {
+			bool invariant = false;
+			for (SizeType j = kept; j < m; ++j) {
+				VectorType& w = basis[j + 1];
+				std::fill(w.begin(),w.end(),ComplexOrRealType(0));
+				matrix_.matrixVectorProduct(w,basis[j]);
+				orthogonalize(t,w,basis,j);
+				beta = norm(w);
+				if (beta < 1e-12) {
+					invariant = true;
+					mEff = j + 1;
+					beta = 0;
+					break;
+				}
+
+				scale(w,1.0/beta);
+				if (j + 1 < m) t(j,j + 1) = t(j + 1,j) = beta;
+			}
+
+			diagonalize(y,theta,t,mEff);
+			bool converged = true;
+			for (SizeType c = 0; c < k; ++c) {
+				RealType residual = fabs(beta*y(mEff - 1,c));
+				if (residual > params_.tolerance*std::max(RealType(1),fabs(theta[c])))
+					converged = false;
+			}
+
+			if (converged || invariant || restarts_ == params_.maxRestarts) {
+				if (!converged && !invariant)
+					std::cerr<<"ThickRestartLanczos: not converged after "<<restarts_<<" restarts\n";
+				break;
+			}
+
+			SizeType keep = std::min(k + (mEff - k)/2,mEff - 1);
+			rotate(basis,y,mEff,keep);
+			basis[keep].swap(basis[m]);
+			for (SizeType i = 0; i < m; ++i)
+				for (SizeType j = 0; j < m; ++j)
+					t(i,j) = 0;
+
+			for (SizeType c = 0; c < keep; ++c) {
+				t(c,c) = theta[c];
+				t(c,keep) = t(keep,c) = beta*y(mEff - 1,c);
+			}
+
+			kept = keep;
+			mEff = m;
+		}
+
+		SizeType total = std::min(k,mEff);
+		eigs.resize(total);
+		vecs.resize(n_,total);
+		for (SizeType c = 0; c < total; ++c) {
+			eigs[c] = theta[c];
+			for (SizeType i = 0; i < n_; ++i) {
+				ComplexOrRealType sum = 0;
+				for (SizeType l = 0; l < mEff; ++l)
+					sum += basis[l][i]*y(l,c);
+				vecs(i,c) = sum;
+			}
+		}
+	}
+
+	SizeType restarts() const { return restarts_; }
+
+private:
+
+	// Two passes of Gram-Schmidt against v_0 ... v_j; column j of T
+	// gets the coefficients, which is <v_i|H v_j> for all i <= j
+	static void orthogonalize(MatrixRealType& t,
+	                          VectorType& w,
+	                          const VectorVectorType& basis,
+	                          SizeType j)
+	{
+		for (SizeType i = 0; i <= j; ++i)
+			t(i,j) = 0;
+
+		for (SizeType pass = 0; pass < 2; ++pass) {
+			for (SizeType i = 0; i <= j; ++i) {
+				ComplexOrRealType h = scalarProduct(basis[i],w);
+				for (SizeType x = 0; x < w.size(); ++x)
+					w[x] -= h*basis[i][x];
+				t(i,j) += PsimagLite::real(h);
+			}
+		}
+
+		for (SizeType i = 0; i < j; ++i)
+			t(j,i) = t(i,j);
+	}
+
+	static void rotate(VectorVectorType& basis,
+	                   const MatrixRealType& y,
+	                   SizeType mEff,
+	                   SizeType keep)
+	{
+		typedef PsimagLite::Parallelizer<RotateTasks> ParallelizerType;
+
+		RotateTasks tasks(basis,y,mEff,keep);
+		ParallelizerType threaded(PsimagLite::Concurrency::npthreads,
+		                          PsimagLite::MPI::COMM_WORLD);
+		threaded.loopCreate(basis[0].size(),tasks);
+	}
+
+	static void diagonalize(MatrixRealType& y,
+	                        VectorRealType& theta,
+	                        const MatrixRealType& t,
+	                        SizeType mEff)
+	{
+		MatrixRealType tmp(mEff,mEff);
+		for (SizeType i = 0; i < mEff; ++i)
+			for (SizeType j = 0; j < mEff; ++j)
+				tmp(i,j) = t(i,j);
+
+		theta.resize(mEff);
+		diag(tmp,theta,'V');
+		y = tmp;
+	}
+
+	static ComplexOrRealType scalarProduct(const VectorType& a, const VectorType& b)
+	{
+		ComplexOrRealType sum = 0;
+		for (SizeType i = 0; i < a.size(); ++i)
+			sum += PsimagLite::conj(a[i])*b[i];
+		return sum;
+	}
+
+	static RealType norm(const VectorType& v)
+	{
+		return sqrt(PsimagLite::real(scalarProduct(v,v)));
+	}
+
+	static void scale(VectorType& v, RealType factor)
+	{
+		for (SizeType i = 0; i < v.size(); ++i)
+			v[i] *= factor;
+	}
+
+	const MatrixType& matrix_;
+	SizeType n_;
+	ParamsType params_;
+	SizeType restarts_;
+}; // class ThickRestartLanczos
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_THICK_RESTART_LANCZOS_H
@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+/*! \file TimeDependentHamiltonian.h
+ *
+ *  H(t) = H0 + f(t)V with V diagonal.
+ *  H0 and V are built once; setTime(t) only changes a scalar, and
+ *  x += H(t)y is done in a single sweep over the rows of H0.
+ *  On the fly, H0 is applied by the model and only V is stored.
+ *
+ */
+#ifndef LANCZOS_TIME_DEPENDENT_HAMILTONIAN_H
+#define LANCZOS_TIME_DEPENDENT_HAMILTONIAN_H
+#include "CrsMatrix.h"
+#include "Vector.h"
+#include "TimeEnvelope.h"
+
+namespace LanczosPlusPlus {
+
+template<typename ModelType>
+class TimeDependentHamiltonian {
+
+public:
+
+	typedef typename ModelType::RealType RealType;
+	typedef typename ModelType::ComplexOrRealType ComplexOrRealType;
+	typedef typename ModelType::BasisBaseType BasisType;
+	typedef typename ModelType::SparseMatrixType SparseMatrixType;
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+	typedef TimeEnvelope<RealType> TimeEnvelopeType;
+
+	TimeDependentHamiltonian(const ModelType& model,
+	                         const BasisType& basis,
+	                         const TimeEnvelopeType& envelope,
+	                         bool onthefly = false)
+	    : model_(model),
+	      basis_(basis),
+	      envelope_(envelope),
+	      onthefly_(onthefly),
+	      factor0_(model.timeFactor()),
+	      factor_(0)
+	{
+		// on the fly only the diagonal of V is stored
+		if (!onthefly_) model.setupHamiltonian(matrix_,basis);
+		model.setupTimeDependentPotential(potential_,basis);
+		assert(potential_.size() == basis.size());
+		setTime(0);
+	}
+
+	void setTime(RealType t)
+	{
+		// setupHamiltonian already includes factor0_ V
+		factor_ = envelope_(t) - factor0_;
+	}
+
+	SizeType rank() const { return potential_.size(); }
+
+	template<typename SomeVectorType>
+	void matrixVectorProduct(SomeVectorType &x, SomeVectorType const &y) const
+	{
+		SizeType n = potential_.size();
+		assert(x.size() == n && y.size() == n);
+		if (onthefly_) {
+			model_.matrixVectorProduct(x,y,basis_);
+			for (SizeType i = 0; i < n; ++i)
+				x[i] += factor_*potential_[i]*y[i];
+			return;
+		}
+
+		for (SizeType i = 0; i < n; ++i) {
+			typename SomeVectorType::value_type sum = factor_*potential_[i]*y[i];
+			SizeType end = matrix_.getRowPtr(i + 1);
+			for (SizeType k = matrix_.getRowPtr(i); k < end; ++k)
+				sum += matrix_.getValue(k)*y[matrix_.getCol(k)];
+			x[i] += sum;
+		}
+	}
+
+private:
+
+	const ModelType& model_;
+	const BasisType& basis_;
+	const TimeEnvelopeType& envelope_;
+	bool onthefly_;
+	RealType factor0_;
+	RealType factor_;
+	SparseMatrixType matrix_;
+	VectorRealType potential_;
+}; // class TimeDependentHamiltonian
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_TIME_DEPENDENT_HAMILTONIAN_H
@@ -0,0 +1,141 @@
+/*
+Copyright (c) 2009-2017, UT-Battelle, LLC
+All rights reserved
+
+[Lanczos++, Version 1.0.0]
+
+*********************************************************
+THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+PARTICULAR PURPOSE ARE DISCLAIMED.
+
+Please see full open source license included in file LICENSE.
+*********************************************************
+
+*/
+
+#ifndef LANCZOS_TIME_ENVELOPE_H
+#define LANCZOS_TIME_ENVELOPE_H
+#include <algorithm>
+#include <cassert>
+#include "Vector.h"
+#include "TypeToString.h"
+
+namespace LanczosPlusPlus {
+
+/* PSIDOC TimeEnvelope
+The time dependence f(t) of $H(t)=H_0 + f(t)V$ is read from the input file
+\begin{itemize}
+\item[TimeEnvelope=] One of cos, pulse, or table.
+\item[TimeEnvelopeAmplitude=] Amplitude A (default 1).
+\item[TimeEnvelopeOmega=] Frequency $\omega$ (default 0).
+\item[TimeEnvelopeCenter=] Center $t_0$ of the pulse.
+\item[TimeEnvelopeWidth=] Width $\sigma$ of the pulse.
+\item[TimeEnvelopeTimes] Vector of times for table.
+\item[TimeEnvelopeValues] Vector of values for table, linearly interpolated.
+\end{itemize}
+cos means $f(t)=A\cos(\omega t)$, and pulse means
+$f(t)=A\cos(\omega (t-t_0))\exp(-(t-t_0)^2/(2\sigma^2))$.
+*/
+template<typename RealType>
+class TimeEnvelope {
+
+	typedef typename PsimagLite::Vector<RealType>::Type VectorRealType;
+
+public:
+
+	enum EnvelopeEnum {COS, PULSE, TABLE};
+
+	template<typename InputType>
+	TimeEnvelope(InputType& io)
+	    : type_(COS),amplitude_(1.0),omega_(0),center_(0),width_(1.0)
+	{
+		PsimagLite::String name("cos");
+		io.readline(name,"TimeEnvelope=");
+
+		try {
+			io.readline(amplitude_,"TimeEnvelopeAmplitude=");
+		} catch (std::exception&) {}
+
+		try {
+			io.readline(omega_,"TimeEnvelopeOmega=");
+		} catch (std::exception&) {}
+
+		if (name == "cos") {
+			type_ = COS;
+		} else if (name == "pulse") {
+			type_ = PULSE;
+			io.readline(center_,"TimeEnvelopeCenter=");
+			io.readline(width_,"TimeEnvelopeWidth=");
+			if (width_ <= 0)
+				throw PsimagLite::RuntimeError("TimeEnvelope: width must be positive\n");
+		} else if (name == "table") {
+			type_ = TABLE;
+			io.read(times_,"TimeEnvelopeTimes");
+			io.read(values_,"TimeEnvelopeValues");
+			checkTable();
+		} else {
+			PsimagLite::String str(__FILE__);
+			str += " " + ttos(__LINE__) + "\n";
+			str += "TimeEnvelope: unknown envelope " + name + "\n";
+			throw PsimagLite::RuntimeError(str);
+		}
+	}
+
+	RealType operator()(RealType t) const
+	{
+		switch (type_) {
+		case COS:
+			return amplitude_*cos(omega_*t);
+		case PULSE:
+		{
+			RealType tmp = t - center_;
+			return amplitude_*cos(omega_*tmp)*exp(-0.5*tmp*tmp/(width_*width_));
+		}
+		default:
+			return amplitude_*interpolate(t);
+		}
+	}
+
+private:
+
+	void checkTable() const
+	{
+		if (times_.size() != values_.size() || times_.size() == 0)
+			throw PsimagLite::RuntimeError("TimeEnvelope: bad table\n");
+
+		for (SizeType i = 1; i < times_.size(); ++i) {
+			if (times_[i] > times_[i-1]) continue;
+			throw PsimagLite::RuntimeError("TimeEnvelope: times must increase\n");
+		}
+	}
+
+	// constant beyond the ends of the table
+	RealType interpolate(RealType t) const
+	{
+		SizeType n = times_.size();
+		if (t <= times_[0]) return values_[0];
+		if (t >= times_[n-1]) return values_[n-1];
+
+		typename VectorRealType::const_iterator it = std::upper_bound(times_.begin(),
+		                                                              times_.end(),
+		                                                              t);
+		SizeType i = it - times_.begin();
+		assert(i > 0 && i < n);
+		RealType x = (t - times_[i-1])/(times_[i] - times_[i-1]);
+		return values_[i-1] + x*(values_[i] - values_[i-1]);
+	}
+
+	EnvelopeEnum type_;
+	RealType amplitude_;
+	RealType omega_;
+	RealType center_;
+	RealType width_;
+	VectorRealType times_;
+	VectorRealType values_;
+}; // class TimeEnvelope
+} // namespace LanczosPlusPlus
+
+#endif // LANCZOS_TIME_ENVELOPE_H
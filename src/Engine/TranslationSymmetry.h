@@ -22,6 +22,9 @@ Please see full open source license included in file LICENSE.
 #include "ProgressIndicator.h"
 #include "CrsMatrix.h"
 #include "Vector.h"
+#include "FusedProduct.h"
+#include "BlockProduct.h"
+#include "LowestDense.h"
 #include "SparseVector.h"
 
 namespace LanczosPlusPlus {
@@ -246,6 +249,30 @@ public:
 		return matrixStored_[pointer_].matrixVectorProduct(x,y);
 	}
 
+	//! x = a H y + b z in one sweep, returns <y|x>
+	template<typename SomeVectorType>
+	typename SomeVectorType::value_type fusedProduct(SomeVectorType& x,
+	                                                 const SomeVectorType& y,
+	                                                 const SomeVectorType& z,
+	                                                 RealType a,
+	                                                 RealType b,
+	                                                 SizeType threads) const
+	{
+		typedef FusedProduct<SparseMatrixType,SomeVectorType> FusedProductType;
+		return FusedProductType::apply(matrixStored_[pointer_],x,y,z,a,b,threads);
+	}
+
+	//! x += H y for a block of vectors, one column per state
+	void blockProduct(MatrixType& x, const MatrixType& y) const
+	{
+		BlockProduct<ComplexOrRealType>::apply(matrixStored_[pointer_],x,y);
+	}
+
+	void diagonal(VectorRealType& d) const
+	{
+		BlockProduct<ComplexOrRealType>::diagonal(d,matrixStored_[pointer_]);
+	}
+
 	void transformMatrix(typename PsimagLite::Vector<SparseMatrixType>::Type& matrix1,
 	                     const SparseMatrixType& matrix) const
 	{
@@ -286,6 +313,10 @@ public:
 
 	PsimagLite::String name() const { return "translation"; }
 
+	// dumpmatrix is only supported by DefaultSymmetry
+	template<typename DumpOptionsType>
+	void setDumpOptions(const DumpOptionsType&) {}
+
 	void fullDiag(VectorRealType& eigs,MatrixType& fm) const
 	{
 		if (matrixStored_[pointer_].row() > 1000)
@@ -301,6 +332,12 @@ public:
 		std::cout<<fm;
 	}
 
+	//! The k lowest eigenpairs of the current sector only
+	void lowestDense(VectorRealType& eigs,MatrixType& fm,SizeType k) const
+	{
+		LowestDense<ComplexOrRealType>::lowest(eigs,fm,matrixStored_[pointer_],k);
+	}
+
 private:
 
 	void addTo(WordType& yy,SizeType what,SizeType site) const
@@ -238,6 +238,13 @@ public:
 
 	const BasisType& basis() const { return basis_; }
 
+	void diagonal(typename PsimagLite::Vector<RealType>::Type& diag,
+	              const BasisBaseType& basis) const
+	{
+		diag.resize(basis.size());
+		calcDiagonalElements(diag,basis);
+	}
+
 	PsimagLite::String name() const { return __FILE__; }
 
 	BasisType* createBasis(SizeType nup, SizeType ndown) const
@@ -31,6 +31,7 @@ public:
 	typedef typename BasisType::BaseType BasisBaseType;
 	typedef typename BasisType::WordType WordType;
 	typedef typename BaseType::SparseMatrixType SparseMatrixType;
+	typedef typename BaseType::SectorArchiveWriterType SectorArchiveWriterType;
 	typedef typename BaseType::VectorType VectorType;
 	typedef PsimagLite::SparseRow<SparseMatrixType> SparseRowType;
 
@@ -135,6 +136,13 @@ public:
 
 	const BasisType& basis() const { return basis_; }
 
+	void diagonal(typename PsimagLite::Vector<RealType>::Type& diag,
+	              const BasisBaseType& basis) const
+	{
+		diag.resize(basis.size());
+		calcDiagonalElements(diag,basis);
+	}
+
 	void printBasis(std::ostream& os) const
 	{
 		os<<basis_;
@@ -161,6 +169,19 @@ public:
 			printOperatorSz(site,os);
 	}
 
+	void archiveOperators(SectorArchiveWriterType& writer) const
+	{
+		SizeType sites = geometry_.numberOfSites();
+		SizeType nup = basis_.szPlusConst();
+		SizeType ndown = sites - nup;
+		writer.setSector(nup,ndown);
+		for (SizeType site = 0; site < sites; ++site) {
+			SparseMatrixType matrix;
+			setupOperator(matrix,"sz",site);
+			writer.addOperator("Sz",0,site,nup,ndown,matrix);
+		}
+	}
+
 private:
 
 	void printOperatorSz(SizeType site, std::ostream& os) const
@@ -168,15 +189,15 @@ private:
 		SizeType sites = geometry_.numberOfSites();
 		SizeType nup = basis_.szPlusConst();
 		SizeType ndown = sites - nup;
-		MatrixType matrix;
+		SparseMatrixType matrix;
 		setupOperator(matrix,"sz",site);
 		os<<"#Operator_Sz_"<<"_"<<site<<"\n";
 		os<<"#SectorDest 2 "<<nup<<" "<<ndown<<"\n";
-		os<<"#Matrix\n";
-		os<<matrix;
+		BaseType::printOperatorMatrix(os,matrix);
 	}
 
-	void setupOperator(MatrixType& matrix,
+	// Diagonal, so the matrix is sparse
+	void setupOperator(SparseMatrixType& matrix,
 	                   PsimagLite::String operatorName,
 	                   SizeType site) const
 	{
@@ -199,18 +220,25 @@ private:
 		}
 
 		matrix.resize(hilbert,hilbert);
-		matrix.setTo(0.0);
 
 		SizeType orb = 0;
 		SizeType dummy = 0;
+		SizeType counter = 0;
 		for (SizeType ispace=0;ispace<hilbert;ispace++) {
+			matrix.setRow(ispace,counter);
 			WordType ket = basis_(ispace,dummy);
 			// assumes OPERATOR_SZ
 			SizeType val1 = basis_.getN(ket,dummy,site,dummy,orb);
 			RealType tmp = val1 - mp_.twiceTheSpin*0.5;
+			if (tmp == 0) continue;
 
-			matrix(ispace,ispace) = tmp;
+			matrix.pushCol(ispace);
+			matrix.pushValue(tmp);
+			counter++;
 		}
+
+		matrix.setRow(hilbert,counter);
+		matrix.checkValidity();
 	}
 
 	bool hasNewPartsSplusOrMinus(std::pair<SizeType,SizeType>& newParts,
@@ -122,6 +122,13 @@ public:
 
 	const BasisType& basis() const { return basis_; }
 
+	void diagonal(typename PsimagLite::Vector<RealType>::Type& diag,
+	              const BasisBaseType& basis) const
+	{
+		diag.resize(basis.size());
+		calcDiagonalElements(diag,basis);
+	}
+
 	void setupHamiltonian(SparseMatrixType& matrix,
 	                      const BasisBaseType& basis) const
 	{
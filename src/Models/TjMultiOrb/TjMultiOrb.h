@@ -34,8 +34,11 @@ public:
 	typedef typename BasisType::BaseType BasisBaseType;
 	typedef typename BasisType::WordType WordType;
 	typedef typename BaseType::SparseMatrixType SparseMatrixType;
+	typedef typename BaseType::SectorArchiveWriterType SectorArchiveWriterType;
 	typedef typename BaseType::VectorType VectorType;
 	typedef typename BaseType::VectorSizeType VectorSizeType;
+	typedef typename BaseType::OperatorIndexType OperatorIndexType;
+	typedef typename BaseType::PairSizeType PairSizeType;
 	typedef std::pair<WordType,WordType> PairWordType;
 	typedef typename PsimagLite::Vector<PairWordType>::Type VectorPairWordType;
 	typedef PsimagLite::Matrix<SizeType> MatrixSizeType;
@@ -155,6 +158,13 @@ public:
 
 	const BasisType& basis() const { return basis_; }
 
+	void diagonal(typename PsimagLite::Vector<RealType>::Type& diag,
+	              const BasisBaseType& basis) const
+	{
+		diag.resize(basis.size());
+		calcDiagonalElements(diag,basis);
+	}
+
 	void printBasis(std::ostream& os) const
 	{
 		os<<basis_;
@@ -189,6 +199,21 @@ public:
 			printOperatorC(site,spin,os);
 	}
 
+	void archiveOperators(SectorArchiveWriterType& writer) const
+	{
+		SizeType nup = basis_.electrons(SPIN_UP);
+		SizeType ndown = basis_.electrons(SPIN_DOWN);
+		writer.setSector(nup,ndown);
+		SizeType spin = SPIN_UP;
+		for (SizeType site = 0; site < geometry_.numberOfSites(); ++site) {
+			SparseMatrixType matrix;
+			if (operatorC(matrix,site,spin))
+				writer.addOperator("c",spin,site,nup - 1,ndown,matrix);
+			else
+				writer.addOperator("c",spin,site,-1,-1,matrix);
+		}
+	}
+
 private:
 
 	void reinterpretAndTruncate(SparseMatrixType& matrix,
@@ -380,33 +405,40 @@ private:
 	{
 		SizeType nup = basis_.electrons(SPIN_UP);
 		SizeType ndown = basis_.electrons(SPIN_DOWN);
-		if (nup == 0) {
+		SparseMatrixType matrix;
+		if (!operatorC(matrix,site,spin)) {
 			os<<"#Operator_c_"<<spin<<"_"<<site<<"\n";
 			os<<"#SectorDest 0\n"; //bogus
-			os<<"#Matrix\n";
-			os<<"0 0\n";
+			BaseType::printOperatorMatrix(os,matrix);
 			return;
 		}
 
-		BasisType*  basis = createBasis(nup-1, ndown);
+		os<<"#Operator_c_"<<spin<<"_"<<site<<"\n";
+		os<<"#SectorDest 2 "<<(nup-1)<<" "<<ndown<<"\n";
+		BaseType::printOperatorMatrix(os,matrix);
+	}
+
+	// Returns false if there is no destination sector
+	bool operatorC(SparseMatrixType& matrix, SizeType site, SizeType spin) const
+	{
+		SizeType nup = basis_.electrons(SPIN_UP);
+		SizeType ndown = basis_.electrons(SPIN_DOWN);
+		if (nup == 0) return false;
+
+		const BasisBaseType& basis = BaseType::sectorBasis(PairSizeType(nup-1, ndown));
 		VectorSizeType opt(2,0);
 		opt[0] = site;
 		opt[1] = spin;
-		MatrixType matrix;
-		setupOperator(matrix,*basis,"c",opt);
-		os<<"#Operator_c_"<<spin<<"_"<<site<<"\n";
-		os<<"#SectorDest 2 "<<(nup-1)<<" "<<ndown<<"\n";
-		os<<"#Matrix\n";
-		os<<matrix;
+		setupOperator(matrix,basis,"c",opt);
+		return true;
 	}
 
-	void setupOperator(MatrixType& matrix,
+	// At most one nonzero per row, taken from the operator cache
+	void setupOperator(SparseMatrixType& matrix,
 	                   const BasisBaseType& basis,
 	                   PsimagLite::String operatorName,
 	                   const VectorSizeType& operatorOptions) const
 	{
-		SizeType hilbertDest = basis.size();
-		SizeType hilbertSrc = basis_.size();
 		SizeType nsite = geometry_.numberOfSites();
 		SizeType id = 0;
 		if (operatorName == "c") {
@@ -435,21 +467,14 @@ private:
 		}
 
 		SizeType spin = operatorOptions[1];
-		matrix.resize(hilbertSrc,hilbertDest);
-		matrix.setTo(0.0);
 		SizeType orb = 0;
-
-		for (SizeType ispace=0;ispace<hilbertSrc;ispace++) {
-			WordType ket1 = basis_(ispace,SPIN_UP);
-			WordType ket2 = basis_(ispace,SPIN_DOWN);
-			WordType bra = ket1;
-			// assumes OPERATOR_C
-			bool b = basis.getBra(bra,ket1,ket2,id,site,spin);
-			if (!b) continue;
-			SizeType index = basis.perfectIndex(bra,ket2);
-
-			matrix(ispace,index) = basis.doSignGf(bra,ket2,site,spin,orb);
-		}
+		const OperatorIndexType& op = BaseType::operatorCache()(id,
+		                                                        site,
+		                                                        spin,
+		                                                        orb,
+		                                                        basis,
+		                                                        PsimagLite::Concurrency::npthreads);
+		BaseType::operatorMatrix(matrix,op,basis_.size());
 	}
 
 	bool hasNewPartsCorCdagger(std::pair<SizeType,SizeType>& newParts,
@@ -31,7 +31,7 @@ if (defined($arg) and -r "$arg" and $arg ne "Config.make") {
 	system($cmd);
 }
 
-my @drivers = ("lanczos","thermal","lorentzian");
+my @drivers = ("lanczos","thermal","lorentzian","lanczosExact","ftlm","tpq");
 
 createMakefile();
 
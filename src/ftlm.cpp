@@ -0,0 +1,223 @@
+#include "AllocatorCpu.h"
+#include "Version.h"
+#include "../../PsimagLite/src/Version.h"
+PsimagLite::String license = "Copyright (c) 2009-2017, UT-Battelle, LLC\n"
+                             "All rights reserved\n"
+                             "\n"
+                             "[Lanczos++, Version 1.0]\n"
+                             "\n"
+                             "-------------------------------------------------------------\n"
+                             "THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND\n"
+                             "CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED\n"
+                             "WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED\n"
+                             "WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A\n"
+                             "PARTICULAR PURPOSE ARE DISCLAIMED. \n"
+                             "\n"
+                             "Please see full open source license included in file LICENSE.\n"
+                             "-------------------------------------------------------------\n"
+                             "\n";
+
+#include <unistd.h>
+#include <cstdlib>
+#include <getopt.h>
+#include "Concurrency.h"
+#include "ProgramGlobals.h"
+#include "ModelSelector.h"
+#include "Geometry/Geometry.h"
+#include "InternalProductOnTheFly.h"
+#include "InternalProductStored.h"
+#include "InputNg.h" // in PsimagLite
+#include "InputCheck.h"
+#include "Tokenizer.h"
+#include "FiniteTemperatureLanczos.h"
+
+using namespace LanczosPlusPlus;
+
+#ifndef USE_FLOAT
+typedef double RealType;
+#else
+typedef float RealType;
+#endif
+
+typedef std::complex<RealType> ComplexType;
+
+#ifdef USE_COMPLEX
+typedef ComplexType ComplexOrRealType;
+#else
+typedef RealType ComplexOrRealType;
+#endif
+
+typedef PsimagLite::Concurrency ConcurrencyType;
+typedef PsimagLite::InputNg<InputCheck> InputNgType;
+typedef PsimagLite::Geometry<ComplexOrRealType,
+InputNgType::Readable,
+ProgramGlobals> GeometryType;
+typedef ModelSelector<ComplexOrRealType,GeometryType,InputNgType::Readable> ModelSelectorType;
+typedef ModelSelectorType::ModelBaseType ModelBaseType;
+typedef PsimagLite::Vector<RealType>::Type VectorRealType;
+typedef FtlmParams<RealType> FtlmParamsType;
+
+void usage(const char* name)
+{
+	std::cerr<<"USAGE: "<<name<<" -f file -b beta1[,beta2,...] [-m mu1[,mu2,...]] ";
+	std::cerr<<"[-R samples] [-M steps] [-S seed] [-c n|sz -s site] [-n particles] ";
+	std::cerr<<"[-p precision]\n";
+}
+
+void fillVector(VectorRealType& v, PsimagLite::String str)
+{
+	PsimagLite::Vector<PsimagLite::String>::Type tokens;
+	PsimagLite::tokenizer(str,tokens,",");
+	v.clear();
+	for (SizeType i = 0; i < tokens.size(); ++i)
+		v.push_back(atof(tokens[i].c_str()));
+}
+
+template<template<typename,typename> class InternalProductTemplate>
+void mainLoop(const ModelBaseType& model,
+              const FtlmParamsType& params,
+              int particles,
+              const VectorRealType& betas,
+              const VectorRealType& mus)
+{
+	typedef FiniteTemperatureLanczos<ModelBaseType,InternalProductTemplate> FtlmType;
+
+	if (model.name().find("Heisenberg.h") != PsimagLite::String::npos)
+		throw PsimagLite::RuntimeError("ftlm: Heisenberg model not supported yet\n");
+
+	bool isTj = (model.name().find("TjMultiOrb.h") != PsimagLite::String::npos);
+	SizeType maxPerSpin = 0;
+	for (SizeType site = 0; site < model.geometry().numberOfSites(); ++site)
+		maxPerSpin += model.orbitals(site);
+
+	FtlmType ftlm(model,params);
+	for (SizeType nup = 0; nup <= maxPerSpin; ++nup) {
+		for (SizeType ndown = 0; ndown <= maxPerSpin; ++ndown) {
+			if (particles >= 0 && nup + ndown != static_cast<SizeType>(particles))
+				continue;
+			if (isTj && nup + ndown > maxPerSpin) continue;
+			ftlm.addSector(nup,ndown);
+		}
+	}
+
+	ftlm.print(std::cout,betas,mus);
+}
+
+int main(int argc,char *argv[])
+{
+	int opt = 0;
+	PsimagLite::String file = "";
+	FtlmParamsType params;
+	VectorRealType betas;
+	VectorRealType mus(1,0.0);
+	int particles = -1;
+	InputCheck inputCheck;
+	int precision = 6;
+
+	/* PSIDOC FtlmDriver
+	Finite-temperature Lanczos method.
+	Every (nup,ndown) sector is sampled with random vectors and short Lanczos chains;
+	only the Ritz values and overlaps are kept, so that all temperatures and
+	chemical potentials of the grid are obtained from the same run.
+	The output has one line per (beta,mu) with
+	the logarithm of the partition function, the energy, the density, and
+	optionally the static correlation $\langle O_i O_j\rangle$ for all j.
+	Random vectors of a sector are sampled in parallel if Threads= is
+	larger than one in the input file. Sectors are done one after the other,
+	so that only the basis and Hamiltonian of one sector are held in memory;
+	use at least as many random vectors as threads.
+	\begin{itemize}
+	\item[-f file] Input file.
+	\item[-b betas] Comma-separated list of inverse temperatures.
+	\item[-m mus] Comma-separated list of chemical potentials (default 0).
+	\item[-R samples] Random vectors per sector (default 10).
+	\item[-M steps] Lanczos steps per random vector (default 100).
+	\item[-S seed] Seed of the random number generator.
+	\item[-c operator] Either n or sz; computes $\langle O_i O_j\rangle$.
+	\item[-s site] The site i above (default 0).
+	\item[-n particles] Restricts the sum to sectors with this number of particles
+	(canonical ensemble).
+	\item[-p precision] precision in decimals to use.
+	\end{itemize}
+	*/
+	while ((opt = getopt(argc, argv, "f:b:m:R:M:S:c:s:n:p:")) != -1) {
+		switch (opt) {
+		case 'f':
+			file = optarg;
+			break;
+		case 'b':
+			fillVector(betas,optarg);
+			break;
+		case 'm':
+			fillVector(mus,optarg);
+			break;
+		case 'R':
+			params.samples = atoi(optarg);
+			break;
+		case 'M':
+			params.steps = atoi(optarg);
+			break;
+		case 'S':
+			params.seed = atol(optarg);
+			break;
+		case 'c':
+			params.operatorName = optarg;
+			break;
+		case 's':
+			params.site = atoi(optarg);
+			break;
+		case 'n':
+			particles = atoi(optarg);
+			break;
+		case 'p':
+			precision = atoi(optarg);
+			std::cout.precision(precision);
+			std::cerr.precision(precision);
+			break;
+		default: /* '?' */
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (file == "" || betas.size() == 0 || mus.size() == 0 || params.samples == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	//! setup distributed parallelization
+	SizeType npthreads = 1;
+	ConcurrencyType concurrency(&argc,&argv,npthreads);
+
+	// print license
+	if (ConcurrencyType::root()) {
+		std::cerr<<license;
+		std::cerr<<"Lanczos++ Version "<<LANCZOSPP_VERSION<<"\n";
+		std::cerr<<"PsimagLite version "<<PSIMAGLITE_VERSION<<"\n";
+	}
+
+	InputNgType::Writeable ioWriteable(file,inputCheck);
+	InputNgType::Readable io(ioWriteable);
+	GeometryType geometry(io);
+
+	try {
+		io.readline(npthreads,"Threads=");
+		ConcurrencyType::npthreads = npthreads;
+	} catch (std::exception&) {}
+
+	inputCheck.checkForThreads(ConcurrencyType::npthreads);
+
+	ModelSelectorType modelSelector(io,geometry);
+	const ModelBaseType& model = modelSelector();
+	std::cout<<model;
+
+	PsimagLite::String tmp;
+	io.readline(tmp,"SolverOptions=");
+	bool onthefly = (tmp.find("InternalProductOnTheFly") != PsimagLite::String::npos);
+
+	if (onthefly)
+		mainLoop<InternalProductOnTheFly>(model,params,particles,betas,mus);
+	else
+		mainLoop<InternalProductStored>(model,params,particles,betas,mus);
+}
+
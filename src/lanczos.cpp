@@ -37,6 +37,9 @@ PsimagLite::String license = "Copyright (c) 2009-2012, UT-Battelle, LLC\n"
 #include "Tokenizer.h"
 #include "InputCheck.h"
 #include "ReducedDensityMatrix.h"
+#include "DiagonalCorrelators.h"
+#include "SpectralGrid.h"
+#include "GroundStateFile.h"
 
 using namespace LanczosPlusPlus;
 
@@ -62,18 +65,31 @@ ProgramGlobals> GeometryType;
 typedef std::pair<SizeType,SizeType> PairType;
 typedef ModelSelector<ComplexOrRealType,GeometryType,InputNgType::Readable> ModelSelectorType;
 typedef ModelSelectorType::ModelBaseType ModelBaseType;
+typedef SpectralGridParams<RealType> SpectralGridParamsType;
 
 struct LanczosOptions {
 
 	LanczosOptions()
-	    : split(-1),spins(1,PairType(0,0))
+	    : split(-1),
+	      momentum(false),
+	      allPairs(false),
+	      diagonal(false),
+	      recompute(false),
+	      spins(1,PairType(0,0))
 	{}
 
 	int split;
+	bool momentum;
+	bool allPairs;
+	bool diagonal;
+	bool recompute;
+	PsimagLite::String file;
 	PsimagLite::Vector<SizeType>::Type cicj;
 	PsimagLite::Vector<SizeType>::Type gf;
 	PsimagLite::Vector<SizeType>::Type sites;
 	PsimagLite::Vector<PairType>::Type spins;
+	PsimagLite::Vector<PairType>::Type sitePairs;
+	SpectralGridParamsType grid;
 
 }; // struct LanczosOptions
 
@@ -102,6 +118,97 @@ SizeType maxOrbitals(const ModelType& model)
 	return res;
 }
 
+template<typename EngineType, typename ModelType>
+void momentumSpectral(const EngineType& engine,
+                      const ModelType& model,
+                      SizeType gfI,
+                      const LanczosOptions& lanczosOptions)
+{
+	typedef typename EngineType::TridiagonalMatrixType TridiagonalMatrixType;
+	typedef PsimagLite::ContinuedFraction<TridiagonalMatrixType> ContinuedFractionType;
+	typedef PsimagLite::ContinuedFractionCollection<ContinuedFractionType>
+	        ContinuedFractionCollectionType;
+
+	std::cout<<"#gf(q)\n";
+	typename EngineType::VectorStringType vstr;
+	PsimagLite::IoSimple::Out ioOut(std::cout);
+	ContinuedFractionCollectionType cfCollection(PsimagLite::FREQ_REAL);
+	typename EngineType::SpectralGridType grid(lanczosOptions.grid,
+	                                           ProgramGlobals::isFermionic(gfI));
+	typename EngineType::SpectralGridType* gridPtr = (lanczosOptions.grid.enabled()) ?
+	            &grid : 0;
+	SizeType norbitals = maxOrbitals(model);
+	for (SizeType orb = 0; orb < norbitals; ++orb) {
+		for (SizeType i = 0; i < lanczosOptions.spins.size(); ++i) {
+			const PairType& spins = lanczosOptions.spins[i];
+			if (spins.first != spins.second)
+				throw std::runtime_error("-q: no support yet for off-diagonal spin\n");
+			std::cout<<"orbital="<<orb<<" spin="<<spins.first<<"\n";
+			engine.momentumSpectralFunction(cfCollection,vstr,gfI,spins.first,orb,gridPtr);
+		}
+	}
+
+	ioOut<<"#INDEXTOCF ";
+	for (SizeType i = 0; i < vstr.size(); ++i)
+		ioOut<<vstr[i]<<" ";
+	ioOut<<"\n";
+	cfCollection.save(ioOut);
+	if (gridPtr) grid.print(std::cout,"momentum");
+}
+
+template<typename EngineType, typename ModelType>
+void batchSpectral(const EngineType& engine,
+                   const ModelType& model,
+                   SizeType gfI,
+                   const LanczosOptions& lanczosOptions)
+{
+	typedef typename EngineType::TridiagonalMatrixType TridiagonalMatrixType;
+	typedef PsimagLite::ContinuedFraction<TridiagonalMatrixType> ContinuedFractionType;
+	typedef PsimagLite::ContinuedFractionCollection<ContinuedFractionType>
+	        ContinuedFractionCollectionType;
+	typedef typename EngineType::SpectralGridType SpectralGridType;
+
+	PsimagLite::Vector<PairType>::Type sitePairs = lanczosOptions.sitePairs;
+	if (lanczosOptions.allPairs) {
+		SizeType total = model.geometry().numberOfSites();
+		for (SizeType i = 0; i < total; ++i)
+			for (SizeType j = i; j < total; ++j)
+				sitePairs.push_back(PairType(i,j));
+	}
+
+	SizeType npairs = sitePairs.size();
+	typename PsimagLite::Vector<ContinuedFractionCollectionType>::Type
+	        cfCollections(npairs,ContinuedFractionCollectionType(PsimagLite::FREQ_REAL));
+	typename PsimagLite::Vector<typename EngineType::VectorStringType>::Type vstrs(npairs);
+	SpectralGridType grid(lanczosOptions.grid,ProgramGlobals::isFermionic(gfI));
+	typename PsimagLite::Vector<SpectralGridType>::Type grids(npairs,grid);
+	typename PsimagLite::Vector<SpectralGridType>::Type* gridsPtr = (lanczosOptions.grid.enabled()) ?
+	            &grids : 0;
+	SizeType norbitals = maxOrbitals(model);
+	for (SizeType orb1=0;orb1<norbitals;orb1++) {
+		for (SizeType orb2=orb1;orb2<norbitals;orb2++) {
+			engine.spectralFunctionBatch(cfCollections,
+			                             vstrs,
+			                             gfI,
+			                             sitePairs,
+			                             lanczosOptions.spins,
+			                             PairType(orb1,orb2),
+			                             gridsPtr);
+		}
+	}
+
+	PsimagLite::IoSimple::Out ioOut(std::cout);
+	for (SizeType p = 0; p < npairs; ++p) {
+		std::cout<<"#gf(i="<<sitePairs[p].first<<",j="<<sitePairs[p].second<<")\n";
+		ioOut<<"#INDEXTOCF ";
+		for (SizeType i = 0; i < vstrs[p].size(); ++i)
+			ioOut<<vstrs[p][i]<<" ";
+		ioOut<<"\n";
+		cfCollections[p].save(ioOut);
+		if (gridsPtr) grids[p].print(std::cout,sitePairs[p].first,sitePairs[p].second);
+	}
+}
+
 template<typename ModelType,
          typename SpecialSymmetryType,
          template<typename,typename> class InternalProductTemplate>
@@ -113,7 +220,8 @@ void mainLoop3(const ModelType& model,
 	typedef typename EngineType::TridiagonalMatrixType TridiagonalMatrixType;
 
 	const GeometryType& geometry = model.geometry();
-	EngineType engine(model,geometry.numberOfSites(),io);
+	GroundStateFileParams gsFile(io,lanczosOptions.file,lanczosOptions.recompute);
+	EngineType engine(model,geometry.numberOfSites(),io,gsFile);
 
 	//! get the g.s.:
 	RealType Eg = engine.gsEnergy();
@@ -121,6 +229,16 @@ void mainLoop3(const ModelType& model,
 	std::cout<<"Energy="<<Eg<<"\n";
 	for (SizeType gfi=0;gfi<lanczosOptions.gf.size();gfi++) {
 		SizeType gfI = lanczosOptions.gf[gfi];
+		if (lanczosOptions.momentum) {
+			momentumSpectral(engine,model,gfI,lanczosOptions);
+			continue;
+		}
+
+		if (lanczosOptions.allPairs || lanczosOptions.sitePairs.size() > 0) {
+			batchSpectral(engine,model,gfI,lanczosOptions);
+			continue;
+		}
+
  		io.read(lanczosOptions.sites,"TSPSites");
 		if (lanczosOptions.sites.size()==0)
 			throw std::runtime_error("No sites in input file!\n");
@@ -137,6 +255,10 @@ void mainLoop3(const ModelType& model,
 		typename EngineType::VectorStringType vstr;
 		PsimagLite::IoSimple::Out ioOut(std::cout);
 		ContinuedFractionCollectionType cfCollection(PsimagLite::FREQ_REAL);
+		typename EngineType::SpectralGridType grid(lanczosOptions.grid,
+		                                           ProgramGlobals::isFermionic(gfI));
+		typename EngineType::SpectralGridType* gridPtr = (lanczosOptions.grid.enabled()) ?
+		            &grid : 0;
 		SizeType norbitals = maxOrbitals(model);
 		for (SizeType orb1=0;orb1<norbitals;orb1++) {
 			for (SizeType orb2=orb1;orb2<norbitals;orb2++) {
@@ -146,7 +268,8 @@ void mainLoop3(const ModelType& model,
 				                        lanczosOptions.sites[0],
 				        lanczosOptions.sites[1],
 				        lanczosOptions.spins,
-				        std::pair<SizeType,SizeType>(orb1,orb2));
+				        std::pair<SizeType,SizeType>(orb1,orb2),
+				        gridPtr);
 			}
 		}
 
@@ -155,6 +278,7 @@ void mainLoop3(const ModelType& model,
 			ioOut<<vstr[i]<<" ";
 		ioOut<<"\n";
 		cfCollection.save(ioOut);
+		if (gridPtr) grid.print(std::cout,lanczosOptions.sites[0],lanczosOptions.sites[1]);
 	}
 
 	for (SizeType cicji=0;cicji<lanczosOptions.cicj.size();cicji++) {
@@ -180,6 +304,11 @@ void mainLoop3(const ModelType& model,
 		reducedDensityMatrix.printAll(std::cout);
 	}
 
+	if (lanczosOptions.diagonal) {
+		DiagonalCorrelators<ModelType> diagonalCorrelators(model,engine.eigenvector());
+		diagonalCorrelators.printAll(std::cout);
+	}
+
 }
 
 
@@ -255,13 +384,25 @@ int main(int argc,char *argv[])
 	\item[-f file] Input file to use. DMRG++ inputs can be used.
 	\item[-s ``s1,s2''] computes correlations or spectral functions for spin s1,s2.
 	Only s1==s2 is supported for now.
+	\item[-d] Computes densities, double occupancy and the density-density and
+	Sz-Sz correlations in one pass over the ground state.
 	\item[-r siteForSplit] Calculates the reduced density matrix with a lattice
 	split at the siteForSplit.
 	\item[-p precision] precision in decimals to use.
+	\item[-w ``begin,end,step,delta''] evaluates the spectral functions of -g
+	for real frequencies $\omega$ from begin to end, at $\omega+i\delta$.
+	\item[-q] computes the spectral functions of -g in momentum space instead of
+	for the sites in TSPSites, with a single ground state computation.
+	\item[-S ``i1,j1;i2,j2''] computes the spectral functions of -g for
+	all these pairs of sites instead of for TSPSites; -S all means all pairs.
+	\item[-m ``beta,total''] evaluates the spectral functions of -g for the
+	first total Matsubara frequencies at inverse temperature beta.
+	\item[-R] computes the ground state even if GroundStateFile= has a valid one,
+	and overwrites it.
 	\item[-V] prints version and exits.
 	\end{itemize}
 	*/
-	while ((opt = getopt(argc, argv, "g:c:f:s:r:p:V")) != -1) {
+	while ((opt = getopt(argc, argv, "g:c:f:s:r:p:w:m:qS:dRV")) != -1) {
 		switch (opt) {
 		case 'g':
 			lanczosOptions.gf.push_back(ProgramGlobals::operator2id(optarg));
@@ -281,11 +422,54 @@ int main(int argc,char *argv[])
 		case 'r':
 			lanczosOptions.split = atoi(optarg);
 			break;
+		case 'd':
+			lanczosOptions.diagonal = true;
+			break;
 		case 'p':
 			precision = atoi(optarg);
 			std::cout.precision(precision);
 			std::cerr.precision(precision);
 			break;
+		case 'w':
+			PsimagLite::tokenizer(optarg,str,",");
+			if (str.size() != 4) {
+				inputCheck.usage(argv[0]);
+				return 1;
+			}
+
+			lanczosOptions.grid = SpectralGridParamsType(atof(str[0].c_str()),
+			                                             atof(str[1].c_str()),
+			                                             atof(str[2].c_str()),
+			                                             atof(str[3].c_str()));
+			str.clear();
+			break;
+		case 'm':
+			PsimagLite::tokenizer(optarg,str,",");
+			if (str.size() != 2) {
+				inputCheck.usage(argv[0]);
+				return 1;
+			}
+
+			lanczosOptions.grid = SpectralGridParamsType(atof(str[0].c_str()),
+			                                             atoi(str[1].c_str()));
+			str.clear();
+			break;
+		case 'q':
+			lanczosOptions.momentum = true;
+			break;
+		case 'S':
+			if (PsimagLite::String(optarg) == "all") {
+				lanczosOptions.allPairs = true;
+				break;
+			}
+
+			PsimagLite::tokenizer(optarg,str,";");
+			fillOrbsOrSpin(lanczosOptions.sitePairs,str);
+			str.clear();
+			break;
+		case 'R':
+			lanczosOptions.recompute = true;
+			break;
 		case 'V':
 			versionOnly = true;
 			break;
@@ -313,6 +497,8 @@ int main(int argc,char *argv[])
 
 	if (versionOnly) return 0;
 
+	lanczosOptions.file = file;
+
 	//Setup the Geometry
 	InputNgType::Writeable ioWriteable(file,inputCheck);
 	InputNgType::Readable io(ioWriteable);
@@ -1,150 +1,388 @@
-/* DO NOT EDIT!!! Changes will be lost. Modify configure.pl instead
- * This driver program was written by configure.pl
- * Lanczos++ (v1.0) by G.A.*/
+#include "AllocatorCpu.h"
+#include "Version.h"
+#include "../../PsimagLite/src/Version.h"
+PsimagLite::String license = "Copyright (c) 2009-2017, UT-Battelle, LLC\n"
+                             "All rights reserved\n"
+                             "\n"
+                             "[Lanczos++, Version 1.0]\n"
+                             "\n"
+                             "-------------------------------------------------------------\n"
+                             "THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND\n"
+                             "CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED\n"
+                             "WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED\n"
+                             "WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A\n"
+                             "PARTICULAR PURPOSE ARE DISCLAIMED. \n"
+                             "\n"
+                             "Please see full open source license included in file LICENSE.\n"
+                             "-------------------------------------------------------------\n"
+                             "\n";
+
 #include <unistd.h>
 #include <cstdlib>
 #include <getopt.h>
-#include "ConcurrencySerial.h"
+#include "Concurrency.h"
 #include "Engine.h"
-#include "HubbardOneOrbital.h"
-#include "ParametersModelHubbard.h"
-#include "Geometry.h"
-#include "InternalProductStored.h"
-#include "IoSimple.h" // in PsimagLite
 #include "ProgramGlobals.h"
-
-#include "ReflectionSymmetry.h"
+#include "ModelSelector.h"
+#include "Geometry/Geometry.h"
+#include "InternalProductOnTheFly.h"
+#include "InternalProductStored.h"
+#include "InputNg.h" // in PsimagLite
+#include "DefaultSymmetry.h"
+#include "InputCheck.h"
+#include "KrylovEvolution.h"
+#include "TimeDependentHamiltonian.h"
 
 using namespace LanczosPlusPlus;
 
+#ifndef USE_FLOAT
 typedef double RealType;
+#else
+typedef float RealType;
+#endif
+
 typedef std::complex<RealType> ComplexType;
-typedef PsimagLite::ConcurrencySerial<RealType> ConcurrencyType;
-typedef PsimagLite::Geometry<RealType,ProgramGlobals> GeometryType;
-typedef ParametersModelHubbard<RealType> ParametersModelType;
-typedef PsimagLite::IoSimple::In IoInputType;
-typedef HubbardOneOrbital<RealType,ParametersModelType,GeometryType> ModelType;
-typedef typename ModelType::BasisType BasisType;
-typedef ReflectionSymmetry<GeometryType,BasisType> ReflectionSymmetryType;
-typedef InternalProductStored<ModelType,ReflectionSymmetryType> InternalProductType;
-typedef Engine<ModelType,InternalProductType,ConcurrencyType> EngineType;
-typedef typename InternalProductType::SparseMatrixType SparseMatrixType;
-typedef std::complex<RealType> ComplexType;
 
-void usage(const char *progName)
+#ifdef USE_COMPLEX
+typedef ComplexType ComplexOrRealType;
+#else
+typedef RealType ComplexOrRealType;
+#endif
+
+typedef PsimagLite::Concurrency ConcurrencyType;
+typedef PsimagLite::InputNg<InputCheck> InputNgType;
+typedef PsimagLite::Geometry<ComplexOrRealType,
+InputNgType::Readable,
+ProgramGlobals> GeometryType;
+typedef ModelSelector<ComplexOrRealType,GeometryType,InputNgType::Readable> ModelSelectorType;
+typedef ModelSelectorType::ModelBaseType ModelBaseType;
+typedef ModelBaseType::BasisBaseType BasisBaseType;
+typedef DefaultSymmetry<GeometryType,BasisBaseType> DefaultSymmetryType;
+typedef PsimagLite::Vector<ComplexType>::Type VectorComplexType;
+
+struct TimeEvolutionOptions {
+
+	TimeEvolutionOptions()
+	    : totalTime(0),
+	      timeStep(0.01),
+	      tolerance(1e-10),
+	      envelopeTolerance(1e-6),
+	      krylovSteps(20)
+	{}
+
+	RealType totalTime;
+	RealType timeStep;
+	RealType tolerance;
+	RealType envelopeTolerance;
+	SizeType krylovSteps;
+}; // struct TimeEvolutionOptions
+
+void usage(const char* name)
+{
+	std::cerr<<"USAGE: "<<name<<" -i initialInput -f evolutionInput -T totalTime ";
+	std::cerr<<"[-t timeStep] [-k krylovSteps] [-e tolerance] [-E envelopeTolerance] ";
+	std::cerr<<"[-p precision]\n";
+}
+
+template<typename ModelType>
+void measure(std::ostream& os,
+             RealType time,
+             const VectorComplexType& psi,
+             ComplexType energy,
+             const ModelType& model)
+{
+	typedef typename ModelType::BasisBaseType::WordType WordType;
+
+	const typename ModelType::BasisBaseType& basis = model.basis();
+	SizeType nsites = model.geometry().numberOfSites();
+	typename PsimagLite::Vector<RealType>::Type density(nsites,0);
+	RealType norm2 = 0;
+	for (SizeType ispace = 0; ispace < psi.size(); ++ispace) {
+		RealType w = std::norm(psi[ispace]);
+		norm2 += w;
+		if (w == 0) continue;
+		WordType ket1 = basis(ispace,ProgramGlobals::SPIN_UP);
+		WordType ket2 = basis(ispace,ProgramGlobals::SPIN_DOWN);
+		for (SizeType site = 0; site < nsites; ++site) {
+			for (SizeType orb = 0; orb < model.orbitals(site); ++orb) {
+				RealType n = basis.getN(ket1,ket2,site,ProgramGlobals::SPIN_UP,orb);
+				n += basis.getN(ket1,ket2,site,ProgramGlobals::SPIN_DOWN,orb);
+				density[site] += w*n;
+			}
+		}
+	}
+
+	os<<time<<" "<<std::real(energy)/norm2<<" "<<norm2;
+	for (SizeType site = 0; site < nsites; ++site)
+		os<<" "<<(density[site]/norm2);
+	os<<"\n";
+}
+
+template<typename HamiltonianType>
+void setTime(HamiltonianType&, RealType) {}
+
+void setTime(TimeDependentHamiltonian<ModelBaseType>& hamiltonian, RealType time)
+{
+	hamiltonian.setTime(time);
+}
+
+// A time-independent Hamiltonian needs no substeps beyond those of the propagator
+template<typename HamiltonianType, typename KrylovEvolutionType>
+SizeType advance(VectorComplexType& psi,
+                 KrylovEvolutionType& krylov,
+                 HamiltonianType&,
+                 RealType,
+                 RealType dt,
+                 const TimeEvolutionOptions&)
+{
+	krylov.evolve(psi,dt,KrylovEvolutionType::REAL_TIME);
+	return 1;
+}
+
+// Exponential midpoint rule with step doubling: a substep h is accepted when
+// one step of h and two steps of h/2 agree within the envelope tolerance,
+// and the two half steps, the more accurate of the two, are kept
+template<typename KrylovEvolutionType>
+SizeType advance(VectorComplexType& psi,
+                 KrylovEvolutionType& krylov,
+                 TimeDependentHamiltonian<ModelBaseType>& hamiltonian,
+                 RealType time,
+                 RealType dt,
+                 const TimeEvolutionOptions& opt)
+{
+	SizeType n = psi.size();
+	VectorComplexType full(n);
+	VectorComplexType half(n);
+	RealType done = 0;
+	RealType h = dt;
+	SizeType substeps = 0;
+	while (dt - done > 1e-12*dt) {
+		if (h > dt - done) h = dt - done;
+		RealType t = time + done;
+
+		full = psi;
+		hamiltonian.setTime(t + 0.5*h);
+		krylov.evolve(full,h,KrylovEvolutionType::REAL_TIME);
+
+		half = psi;
+		hamiltonian.setTime(t + 0.25*h);
+		krylov.evolve(half,0.5*h,KrylovEvolutionType::REAL_TIME);
+		hamiltonian.setTime(t + 0.75*h);
+		krylov.evolve(half,0.5*h,KrylovEvolutionType::REAL_TIME);
+
+		RealType err = 0;
+		for (SizeType i = 0; i < n; ++i)
+			err += std::norm(full[i] - half[i]);
+		err = sqrt(err);
+
+		if (err > opt.envelopeTolerance) {
+			h *= 0.5;
+			if (h >= 1e-8*dt) continue;
+			PsimagLite::String str(__FILE__);
+			str += " " + ttos(__LINE__) + "\n";
+			str += "Time envelope: cannot reach tolerance " + ttos(opt.envelopeTolerance);
+			str += " at time " + ttos(t) + "\n";
+			throw PsimagLite::RuntimeError(str);
+		}
+
+		psi = half;
+		done += h;
+		++substeps;
+		// the local error of the midpoint rule goes as h^3
+		if (err < 0.1*opt.envelopeTolerance) h *= 2;
+	}
+
+	return substeps;
+}
+
+template<typename HamiltonianType>
+void timeLoop(VectorComplexType& psi,
+              HamiltonianType& hamiltonian,
+              const ModelBaseType& model,
+              const TimeEvolutionOptions& opt)
 {
-	std::cerr<<"Usage: "<<progName<<" [-g -i i -j j] -f filename\n";
+	typedef KrylovEvolution<HamiltonianType> KrylovEvolutionType;
+
+	KrylovEvolutionType krylov(hamiltonian,opt.krylovSteps,opt.tolerance);
+
+	std::cout<<"#time energy norm density[0..sites-1]\n";
+	setTime(hamiltonian,0);
+	measure(std::cout,0,psi,krylov.expectationH(psi),model);
+
+	SizeType numberOfTimes = static_cast<SizeType>(opt.totalTime/opt.timeStep + 0.5);
+	for (SizeType i = 1; i <= numberOfTimes; ++i) {
+		RealType time = i*opt.timeStep;
+		SizeType steps = advance(psi,krylov,hamiltonian,time - opt.timeStep,opt.timeStep,opt);
+		setTime(hamiltonian,time);
+		measure(std::cout,time,psi,krylov.expectationH(psi),model);
+		std::cerr<<"time="<<time<<" envelopeSteps="<<steps<<" substeps="<<krylov.substeps();
+		std::cerr<<" mvps="<<krylov.mvps()<<"\n";
+	}
 }
 
-ComplexType proc(PsimagLite::Vector<ComplexType>::Type& psi,
-		 const SparseMatrixType& hmat,
-		 const SparseMatrixType& hIntegral,
-		 const RealType& tau)
+template<template<typename,typename> class InternalProductTemplate>
+void mainLoop(const ModelBaseType& modelInitial,
+              InputNgType::Readable& ioInitial,
+              const ModelBaseType& model,
+              InputNgType::Readable& io,
+              const TimeEvolutionOptions& opt,
+              bool onthefly)
 {
-	PsimagLite::Matrix<ComplexType> fhmat;
-	crsMatrixToFullMatrix(fhmat,hmat);
-
-	SizeType n = fhmat.n_row();
-	PsimagLite::Matrix<ComplexType> fhIntegral(n,n);
-	crsMatrixToFullMatrix(fhIntegral,hIntegral);
-	ComplexType val= ComplexType(0,-tau);
-	fhIntegral = (val * fhIntegral);
-
-	exp(fhIntegral);
-
-	PsimagLite::Vector<ComplexType>::Type psiNew(n);
-	for (SizeType i=0;i<n;i++) {
-		ComplexType sum = 0;
-		for (SizeType j=0;j<n;j++)  sum += fhIntegral(i,j) * psi[j];
-		psiNew[i] = sum;
+	typedef Engine<ModelBaseType,InternalProductTemplate,DefaultSymmetryType> EngineType;
+	typedef InternalProductTemplate<ModelBaseType,DefaultSymmetryType> InternalProductType;
+
+	if (modelInitial.size() != model.size()) {
+		PsimagLite::String str(__FILE__);
+		str += " " + ttos(__LINE__) + "\n";
+		str += "Initial and evolution Hilbert spaces differ: ";
+		str += ttos(modelInitial.size()) + " != " + ttos(model.size()) + "\n";
+		throw PsimagLite::RuntimeError(str);
+	}
+
+	EngineType engine(modelInitial,modelInitial.geometry().numberOfSites(),ioInitial);
+	std::cout<<"#InitialEnergy="<<engine.gsEnergy()<<"\n";
+
+	const typename EngineType::VectorType& gs = engine.eigenvector();
+	VectorComplexType psi(gs.size());
+	for (SizeType i = 0; i < gs.size(); ++i)
+		psi[i] = gs[i];
+
+	bool timeDependent = true;
+	PsimagLite::String envelopeName;
+	try {
+		io.readline(envelopeName,"TimeEnvelope=");
+	} catch (std::exception&) {
+		timeDependent = false;
 	}
 
-	PsimagLite::Vector<ComplexType>::Type v = fhmat * psiNew;
+	if (timeDependent) {
+		TimeEnvelope<RealType> envelope(io);
+		TimeDependentHamiltonian<ModelBaseType> hamiltonian(model,
+		                                                    model.basis(),
+		                                                    envelope,
+		                                                    onthefly);
+		timeLoop(psi,hamiltonian,model,opt);
+		return;
+	}
 
-	//std::cout<<"<psi(0)|S S lambda_i | psi(0)>="<<sum2<<" "<<(2.0*sum2)<<" time="<<time<<"\n";
-	psi = psiNew;
-	return psiNew * v;
+	DefaultSymmetryType symm(model.basis(),model.geometry(),"");
+	InternalProductType hamiltonian(model,model.basis(),symm);
+	timeLoop(psi,hamiltonian,model,opt);
 }
 
 int main(int argc,char *argv[])
 {
 	int opt = 0;
-	bool gf = false;
+	PsimagLite::String fileInitial = "";
 	PsimagLite::String file = "";
-	while ((opt = getopt(argc, argv, "gf:")) != -1) {
+	TimeEvolutionOptions evolutionOptions;
+	InputCheck inputCheck;
+	int precision = 6;
+
+	/* PSIDOC LanczosExactDriver
+	Real-time evolution with short-iteration Lanczos (Krylov) propagation.
+	The initial state is the ground state of the initial input; it is then evolved
+	with the Hamiltonian of the evolution input, which must have the same
+	geometry and quantum numbers.
+	If the evolution input has TimeEnvelope= then the Hamiltonian is
+	$H(t)=H_0 + f(t)V$, where V is the PotentialT term, and $H_0$ and V are built once.
+	See the TimeEnvelope section for f(t). Each time step is split into substeps
+	that use the midpoint $H(t+h/2)$; a substep h is accepted when one step of h
+	and two steps of h/2 differ by less than the envelope tolerance, and is
+	otherwise halved. With InternalProductOnTheFly only the diagonal of V is stored.
+	\begin{itemize}
+	\item[-i file] Input file for the initial state.
+	\item[-f file] Input file for the Hamiltonian of the evolution.
+	\item[-T time] Total time.
+	\item[-t step] Time step at which observables are printed; the propagator
+	subdivides it as needed to keep the error below the tolerance.
+	\item[-k steps] Maximum dimension of the Krylov space (default 20).
+	\item[-e tolerance] Error tolerance per time step (default $10^{-10}$).
+	\item[-E tolerance] Error tolerance per substep of the time envelope
+	(default $10^{-6}$).
+	\item[-p precision] precision in decimals to use.
+	\end{itemize}
+	*/
+	while ((opt = getopt(argc, argv, "i:f:T:t:k:e:E:p:")) != -1) {
 		switch (opt) {
-		case 'g':
-			gf = true;
+		case 'i':
+			fileInitial = optarg;
 			break;
 		case 'f':
 			file = optarg;
 			break;
+		case 'T':
+			evolutionOptions.totalTime = atof(optarg);
+			break;
+		case 't':
+			evolutionOptions.timeStep = atof(optarg);
+			break;
+		case 'k':
+			evolutionOptions.krylovSteps = atoi(optarg);
+			break;
+		case 'e':
+			evolutionOptions.tolerance = atof(optarg);
+			break;
+		case 'E':
+			evolutionOptions.envelopeTolerance = atof(optarg);
+			break;
+		case 'p':
+			precision = atoi(optarg);
+			std::cout.precision(precision);
+			std::cerr.precision(precision);
+			break;
 		default: /* '?' */
 			usage(argv[0]);
 			return 1;
 		}
 	}
-	if (file == "") {
+
+	if (file == "" || fileInitial == "" || evolutionOptions.totalTime <= 0 ||
+	        evolutionOptions.timeStep <= 0) {
 		usage(argv[0]);
 		return 1;
 	}
+
 	//! setup distributed parallelization
-	ConcurrencyType concurrency(argc,argv);
+	SizeType npthreads = 1;
+	ConcurrencyType concurrency(&argc,&argv,npthreads);
+
+	// print license
+	if (ConcurrencyType::root()) {
+		std::cerr<<license;
+		std::cerr<<"Lanczos++ Version "<<LANCZOSPP_VERSION<<"\n";
+		std::cerr<<"PsimagLite version "<<PSIMAGLITE_VERSION<<"\n";
+	}
 
-	//Setup the Geometry
-	IoInputType io(file);
+	InputNgType::Writeable ioWriteableInitial(fileInitial,inputCheck);
+	InputNgType::Readable ioInitial(ioWriteableInitial);
+	GeometryType geometryInitial(ioInitial);
+	ModelSelectorType modelSelectorInitial(ioInitial,geometryInitial);
+
+	InputNgType::Writeable ioWriteable(file,inputCheck);
+	InputNgType::Readable io(ioWriteable);
 	GeometryType geometry(io);
+	ModelSelectorType modelSelector(io,geometry);
 
-	// read model parameters
-	ParametersModelType mp(io);
-
-
-	PsimagLite::Vector<RealType>::Type qns;
-	io.read(qns,"TargetQuantumNumbers");
-	if (qns.size()<2) throw std::runtime_error("HubbardLanczos::ctor(...)\n");
-	SizeType nup=SizeType(geometry.numberOfSites()*qns[0]);
-	SizeType ndown=SizeType(geometry.numberOfSites()*qns[1]);
-
-	ParametersModelType mpTimeIndepedent = mp;
-
-	mpTimeIndepedent.timeFactor = 1.0;
-
-	ModelType modelTimeIndependent2(nup,ndown,mpTimeIndepedent,geometry);
-	SparseMatrixType psiM;
-	modelTimeIndependent2.setupHamiltonian(psiM);
-
-	PsimagLite::Matrix<RealType> fpsi;
-	crsMatrixToFullMatrix(fpsi,psiM);
-	PsimagLite::Vector<RealType>::Type eigs2(fpsi.n_row());
-	diag(fpsi,eigs2,'V');
-	PsimagLite::Vector<ComplexType>::Type psi(eigs2.size());
-	for (SizeType i=0;i<psi.size();i++) psi[i] = fpsi(i,0);
-
-	//! Setup the Models
-	SizeType numberOfTimes = 510;
-	RealType deltaTime = 0.01;
-	RealType omega = 0.8;
-	PsimagLite::Vector<ComplexType>::Type v(numberOfTimes);
-	for (SizeType i=0;i<numberOfTimes;i++) {
-		RealType time = i*deltaTime;
-
-		mp.timeFactor = cos(omega*time);
-		ModelType modelH(nup,ndown,mp,geometry);
-		SparseMatrixType hmat;
-		modelH.setupHamiltonian(hmat);
-
-//		mp.timeFactor = 0;
-//		if (time>0) mp.timeFactor = sin(omega*time)/(omega*deltaTime);
-//		ModelType modelHIntegral(nup,ndown,mp,geometry);
-//		SparseMatrixType hIntegral;
-//		modelHIntegral.setupHamiltonian(hIntegral);
-		v[i] = proc(psi,hmat,hmat,deltaTime);
-		std::cerr<<time<<" "<<v[i]<<"\n";
-	}
+	std::cout<<modelSelector();
 
-	for (SizeType i=0;i<v.size();i++) {
-		RealType time = i*deltaTime;
-		std::cout<<time<<" "<<std::real(v[i])<<"\n";
-	}
+	PsimagLite::String tmp;
+	io.readline(tmp,"SolverOptions=");
+	bool onthefly = (tmp.find("InternalProductOnTheFly") != PsimagLite::String::npos);
+
+	if (onthefly)
+		mainLoop<InternalProductOnTheFly>(modelSelectorInitial(),
+		                                  ioInitial,
+		                                  modelSelector(),
+		                                  io,
+		                                  evolutionOptions,
+		                                  onthefly);
+	else
+		mainLoop<InternalProductStored>(modelSelectorInitial(),
+		                                ioInitial,
+		                                modelSelector(),
+		                                io,
+		                                evolutionOptions,
+		                                onthefly);
 }
 
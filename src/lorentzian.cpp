@@ -1,29 +1,33 @@
 #include <iostream>
-#include <fstream>
 #include <cassert>
 #include <unistd.h>
 #include "Vector.h"
 #include "Sort.h"
 #include "TypeToString.h"
+#include "Tokenizer.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+#include "PoleFile.h"
 
 typedef double RealType;
 typedef std::complex<RealType> ComplexType;
 typedef PsimagLite::Vector<SizeType>::Type VectorSizeType;
 typedef PsimagLite::Vector<RealType>::Type VectorRealType;
+typedef PsimagLite::Vector<ComplexType>::Type VectorComplexType;
+typedef PsimagLite::Vector<PsimagLite::String>::Type VectorStringType;
+typedef LanczosPlusPlus::PoleFileReader<RealType> PoleFileReaderType;
 
-void load(VectorRealType& e, VectorRealType& w,PsimagLite::String file)
+void load(VectorRealType& e, VectorRealType& w, const VectorStringType& files)
 {
-	std::ifstream fin(file.c_str());
-	RealType tmp = 0;
-	while (!fin.eof() && !fin.bad() && fin.good()) {
-		fin>>tmp;
-		if (fin.eof() || fin.bad() || !fin.good()) break;
-		e.push_back(tmp);
-		fin>>tmp;
-		w.push_back(tmp);
-	}
+	for (SizeType f = 0; f < files.size(); ++f) {
+		PoleFileReaderType reader(files[f]);
+		SizeType counter = 0;
+		SizeType chunk = 0;
+		while ((chunk = reader.read(e,w,1000000)) > 0)
+			counter += chunk;
 
-	std::cerr<<"load: "<<e.size()<<" values found in "<<file<<"\n";
+		std::cerr<<"load: "<<counter<<" values found in "<<files[f]<<"\n";
+	}
 }
 
 void sort(VectorRealType& e, VectorRealType& w)
@@ -83,17 +87,38 @@ void prune(VectorRealType& e,
 	std::cerr<<"prune: "<<e.size()<<" values remain after pruning\n";
 }
 
+// w/(z-e) = w(x-e-iy)/((x-e)^2+y^2) with z=x+iy, in real arithmetic and
+// with LANES independent partial sums, so that the compiler vectorizes it
 ComplexType lorentzian(ComplexType z,
                        const VectorRealType& e,
                        const VectorRealType& w)
 {
-	ComplexType sum = 0;
-	for (SizeType i = 0; i < e.size(); ++i) {
-		ComplexType tmp = (z - e[i]);
-		sum += w[i]/tmp;
+	enum {LANES = 4};
+
+	RealType x = std::real(z);
+	RealType y = std::imag(z);
+	RealType y2 = y*y;
+	RealType re[LANES] = {0, 0, 0, 0};
+	RealType im[LANES] = {0, 0, 0, 0};
+	SizeType n = e.size();
+	SizeType blocks = n - n%LANES;
+	for (SizeType i = 0; i < blocks; i += LANES) {
+		for (SizeType l = 0; l < LANES; ++l) {
+			RealType d = x - e[i + l];
+			RealType f = w[i + l]/(d*d + y2);
+			re[l] += f*d;
+			im[l] -= f*y;
+		}
 	}
 
-	return sum;
+	for (SizeType i = blocks; i < n; ++i) {
+		RealType d = x - e[i];
+		RealType f = w[i]/(d*d + y2);
+		re[0] += f*d;
+		im[0] -= f*y;
+	}
+
+	return ComplexType(re[0] + re[1] + re[2] + re[3], im[0] + im[1] + im[2] + im[3]);
 }
 
 ComplexType findOmega(SizeType ind,
@@ -124,18 +149,328 @@ ComplexType findOmega(SizeType ind,
 	throw PsimagLite::RuntimeError(str);
 }
 
+// One task per frequency; adds to values
+class LorentzianTasks {
+
+public:
+
+	LorentzianTasks(const VectorRealType& e,
+	                const VectorRealType& w,
+	                RealType omegaStep,
+	                RealType omegaInit,
+	                RealType eps,
+	                RealType beta,
+	                PsimagLite::String mode,
+	                VectorComplexType& values)
+	    : e_(e),
+	      w_(w),
+	      omegaStep_(omegaStep),
+	      omegaInit_(omegaInit),
+	      eps_(eps),
+	      beta_(beta),
+	      mode_(mode),
+	      values_(values)
+	{}
+
+	void thread_function_(SizeType threadNum,
+	                      SizeType blockSize,
+	                      SizeType total,
+	                      PsimagLite::Concurrency::MutexType*)
+	{
+		for (SizeType p = 0; p < blockSize; ++p) {
+			SizeType taskNumber = threadNum*blockSize + p;
+			if (taskNumber >= total) break;
+			ComplexType z = findOmega(taskNumber,
+			                          total,
+			                          omegaStep_,
+			                          omegaInit_,
+			                          eps_,
+			                          beta_,
+			                          mode_);
+			values_[taskNumber] += lorentzian(z,e_,w_);
+		}
+	}
+
+private:
+
+	const VectorRealType& e_;
+	const VectorRealType& w_;
+	RealType omegaStep_;
+	RealType omegaInit_;
+	RealType eps_;
+	RealType beta_;
+	PsimagLite::String mode_;
+	VectorComplexType& values_;
+}; // class LorentzianTasks
+
+// In place radix 2 FFT; the size of a must be a power of two
+void fft(VectorComplexType& a, bool inverse)
+{
+	SizeType n = a.size();
+	for (SizeType i = 1, j = 0; i < n; ++i) {
+		SizeType bit = n >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j) std::swap(a[i],a[j]);
+	}
+
+	RealType sign = (inverse) ? 1 : -1;
+	VectorComplexType twiddle(n/2);
+	for (SizeType j = 0; j < n/2; ++j)
+		twiddle[j] = ComplexType(cos(2*M_PI*j/n),sign*sin(2*M_PI*j/n));
+
+	for (SizeType len = 2; len <= n; len <<= 1) {
+		SizeType half = len/2;
+		SizeType stride = n/len;
+		for (SizeType i = 0; i < n; i += len) {
+			for (SizeType j = 0; j < half; ++j) {
+				ComplexType u = a[i + j];
+				ComplexType v = a[i + j + half]*twiddle[j*stride];
+				a[i + j] = u + v;
+				a[i + j + half] = u - v;
+			}
+		}
+	}
+
+	if (!inverse) return;
+	for (SizeType i = 0; i < n; ++i)
+		a[i] /= static_cast<RealType>(n);
+}
+
+// Real axis only. Poles are binned onto a grid of spacing h, splitting each
+// weight linearly between its two neighbours, and the grid is convolved
+// with 1/(omega + i eps) by FFT. The error of the linear split, relative to
+// the height 1/eps of a single peak, is below (h/eps)^2/4, so h is the
+// largest divisor of omegaStep such that this is below tolerance.
+// Frequencies are grid points, and the grid spans [lowest, highest];
+// add refuses poles outside it.
+class LorentzianFft {
+
+public:
+
+	LorentzianFft(SizeType total,
+	              RealType omegaStep,
+	              RealType omegaInit,
+	              RealType eps,
+	              RealType tolerance,
+	              RealType lowest,
+	              RealType highest)
+	    : total_(total),eps_(eps),omegaInit_(omegaInit)
+	{
+		if (omegaStep <= 0 || eps <= 0 || tolerance <= 0) {
+			PsimagLite::String str(__FILE__);
+			str += " " + ttos(__LINE__) + "\n";
+			str += "LorentzianFft: step, eps and tolerance must be positive\n";
+			throw PsimagLite::RuntimeError(str);
+		}
+
+		RealType hmax = 2.0*eps*sqrt(tolerance);
+		substeps_ = static_cast<SizeType>(ceil(omegaStep/hmax));
+		if (substeps_ == 0) substeps_ = 1;
+		h_ = omegaStep/substeps_;
+
+		// omegaInit is grid point k0_
+		lowest = std::min(lowest,omegaInit);
+		highest = std::max(highest,omegaInit + (total - 1)*omegaStep);
+		k0_ = static_cast<SizeType>(ceil((omegaInit - lowest)/h_)) + 1;
+		n_ = k0_ + static_cast<SizeType>(floor((highest - omegaInit)/h_)) + 2;
+		SizeType length = 1;
+		while (length < 2*n_)
+			length <<= 1;
+
+		std::cerr<<"LorentzianFft: grid of "<<n_<<" points, spacing "<<h_;
+		std::cerr<<", FFT length "<<length<<"\n";
+		rho_.resize(length,0.0);
+	}
+
+	// Returns false if e is outside the grid
+	bool add(RealType e, RealType w)
+	{
+		RealType u = (e - omegaInit_)/h_ + k0_;
+		if (u < 0 || u >= n_ - 1) return false;
+		SizeType j = static_cast<SizeType>(floor(u));
+		RealType t = u - j;
+		rho_[j] += (1.0 - t)*w;
+		rho_[j + 1] += t*w;
+		return true;
+	}
+
+	//! Adds the convolution to values
+	void finalize(VectorComplexType& values)
+	{
+		assert(values.size() == total_);
+		SizeType length = rho_.size();
+
+		// kernel 1/(m h + i eps) for m = -(n-1),...,n-1, wrapped around
+		VectorComplexType kernel(length,0.0);
+		for (SizeType m = 0; m < n_; ++m) {
+			kernel[m] = 1.0/ComplexType(m*h_,eps_);
+			if (m > 0) kernel[length - m] = 1.0/ComplexType(-(m*h_),eps_);
+		}
+
+		fft(rho_,false);
+		fft(kernel,false);
+		for (SizeType i = 0; i < length; ++i)
+			rho_[i] *= kernel[i];
+		fft(rho_,true);
+
+		for (SizeType i = 0; i < total_; ++i)
+			values[i] += rho_[k0_ + i*substeps_];
+	}
+
+private:
+
+	SizeType total_;
+	RealType eps_;
+	RealType omegaInit_;
+	SizeType substeps_;
+	RealType h_;
+	SizeType k0_;
+	SizeType n_;
+	VectorComplexType rho_;
+}; // class LorentzianFft
+
+// Adds the poles to values, by FFT if fftPtr is not null; poles outside
+// its grid, if any, are summed directly
+void accumulate(VectorComplexType& values,
+                const VectorRealType& e,
+                const VectorRealType& w,
+                RealType omegaStep,
+                RealType omegaInit,
+                RealType eps,
+                RealType beta,
+                PsimagLite::String mode,
+                LorentzianFft* fftPtr)
+{
+	typedef PsimagLite::Parallelizer<LorentzianTasks> ParallelizerType;
+
+	VectorRealType eFar;
+	VectorRealType wFar;
+	if (fftPtr) {
+		for (SizeType i = 0; i < e.size(); ++i) {
+			if (fftPtr->add(e[i],w[i])) continue;
+			eFar.push_back(e[i]);
+			wFar.push_back(w[i]);
+		}
+
+		if (eFar.size() == 0) return;
+	}
+
+	const VectorRealType& eDirect = (fftPtr) ? eFar : e;
+	const VectorRealType& wDirect = (fftPtr) ? wFar : w;
+	LorentzianTasks tasks(eDirect,wDirect,omegaStep,omegaInit,eps,beta,mode,values);
+	ParallelizerType threaded(PsimagLite::Concurrency::npthreads,
+	                          PsimagLite::MPI::COMM_WORLD);
+	threaded.loopCreate(values.size(),tasks);
+}
+
+// Lowest and highest pole with weight above 1e-6, and largest weight,
+// read in chunks
+void scan(RealType& emin,
+          RealType& emax,
+          RealType& wabsmax,
+          const VectorStringType& files,
+          SizeType chunk)
+{
+	for (SizeType f = 0; f < files.size(); ++f) {
+		PoleFileReaderType reader(files[f]);
+		VectorRealType e;
+		VectorRealType w;
+		while (reader.read(e,w,chunk) > 0) {
+			for (SizeType i = 0; i < e.size(); ++i) {
+				if (fabs(w[i]) > wabsmax) wabsmax = fabs(w[i]);
+				if (fabs(w[i]) <= 1e-6) continue;
+				if (e[i] > emax) emax = e[i];
+				if (e[i] < emin) emin = e[i];
+			}
+
+			e.clear();
+			w.clear();
+		}
+	}
+
+	std::cerr<<"scan: emax="<<emax<<" emin="<<emin<<" wabsmax="<<wabsmax<<"\n";
+}
+
+// No sort and no global copy: memory is that of one chunk and the grid
+void stream(VectorComplexType& values,
+            RealType& wabsmax,
+            const VectorStringType& files,
+            SizeType chunk,
+            RealType omegaStep,
+            RealType omegaInit,
+            RealType eps,
+            RealType beta,
+            PsimagLite::String mode,
+            RealType tolerance)
+{
+	SizeType total = values.size();
+	LorentzianFft* fftPtr = 0;
+	if (tolerance > 0) {
+		RealType omegaEnd = omegaInit + (total - 1)*omegaStep;
+		fftPtr = new LorentzianFft(total,
+		                           omegaStep,
+		                           omegaInit,
+		                           eps,
+		                           tolerance,
+		                           omegaInit,
+		                           omegaEnd);
+	}
+
+	SizeType counter = 0;
+	for (SizeType f = 0; f < files.size(); ++f) {
+		PoleFileReaderType reader(files[f]);
+		VectorRealType e;
+		VectorRealType w;
+		while (reader.read(e,w,chunk) > 0) {
+			for (SizeType i = 0; i < w.size(); ++i)
+				if (fabs(w[i]) > wabsmax) wabsmax = fabs(w[i]);
+
+			accumulate(values,e,w,omegaStep,omegaInit,eps,beta,mode,fftPtr);
+			counter += e.size();
+			e.clear();
+			w.clear();
+		}
+	}
+
+	if (fftPtr) fftPtr->finalize(values);
+	delete fftPtr;
+	std::cerr<<"stream: "<<counter<<" values in "<<files.size()<<" files\n";
+}
+
+void print(const VectorComplexType& values,
+           RealType factor,
+           RealType omegaStep,
+           RealType omegaInit,
+           RealType eps,
+           RealType beta,
+           PsimagLite::String mode)
+{
+	SizeType total = values.size();
+	for (SizeType i = 0; i < total; ++i) {
+		ComplexType z = findOmega(i,total,omegaStep,omegaInit,eps,beta,mode);
+		RealType omega = (mode == "real") ? std::real(z) : std::imag(z);
+		ComplexType val = values[i]*factor;
+		std::cout<<omega<<" "<<std::real(val)<<" "<<std::imag(val)<<"\n";
+	}
+}
+
 void usage(char *name, PsimagLite::String msg = "")
 {
 	if (msg != "") std::cerr<<name<<": "<<msg<<"\n";
-	std::cerr<<"USAGE: "<<name<<" -f file -t total -m mode [-e eps] [-b beta] [-s step] [-S start]\n";
+	std::cerr<<"USAGE: "<<name<<" -f file -t total -m mode [-e eps] [-b beta] [-s step] [-S start]";
+	std::cerr<<" [-p threads] [-F tolerance] [-c chunk]\n";
+	std::cerr<<"\tfile can be a comma-separated list of files\n";
 	std::cerr<<"\tmode is either real or matsubara\n";
 	std::cerr<<"\tbeta is mandatory in matsubara mode\n";
+	std::cerr<<"\t-F is for real mode only\n";
 }
 
 int main(int argc, char **argv)
 {
 	int opt = 0;
-	PsimagLite::String file;
+	VectorStringType files;
 	PsimagLite::String mode;
 	RealType eps = 0.1;
 	SizeType total = 0;
@@ -144,10 +479,40 @@ int main(int argc, char **argv)
 	RealType step = 0;
 	bool hasStart = false;
 	bool hasStep = false;
-	while ((opt = getopt(argc, argv, "f:t:m:e:b:s:S:")) != -1) {
+	SizeType threads = 1;
+	RealType tolerance = 0;
+	SizeType chunk = 0;
+
+	/* PSIDOC LorentzianDriver
+	Broadens the poles and weights of thermal, either printed as two numbers per
+	line or written in binary with thermal -P, into $\sum_i w_i/(z-e_i)$,
+	normalized by the largest $|w_i|$.
+	\begin{itemize}
+	\item[-f file] Poles and weights, or a comma-separated list of files, for example
+	one per run of thermal, which are added.
+	\item[-t total] Number of frequencies.
+	\item[-m mode] Either real, for $z=\omega+i\epsilon$, or matsubara.
+	\item[-e eps] Broadening $\epsilon$.
+	\item[-b beta] Inverse temperature, mandatory for matsubara.
+	\item[-s step] Frequency step; defaults to cover all poles.
+	\item[-S start] First frequency; defaults to the lowest pole.
+	\item[-p threads] Frequencies are computed in parallel with this many threads.
+	\item[-F tolerance] Real mode only. Poles are binned onto a fine grid that
+	contains the frequencies, and convolved with the broadening by FFT,
+	at a cost proportional to the number of poles plus $N\log N$, with
+	$N$ the size of the grid. The error relative to the height of one peak
+	is below tolerance. Use it for many poles and dense frequency grids.
+	\item[-c chunk] Streaming: files are read this many poles at a time, and each
+	chunk is added to the frequencies and discarded, without sorting or
+	pruning. Without -S and -s, files are read twice, first to find the
+	range of the poles. With -F, the grid spans only the frequencies, and
+	poles outside it are summed directly.
+	\end{itemize}
+	*/
+	while ((opt = getopt(argc, argv, "f:t:m:e:b:s:S:p:F:c:")) != -1) {
 		switch (opt) {
 		case 'f':
-			file = optarg;
+			PsimagLite::tokenizer(optarg,files,",");
 			break;
 		case 't':
 			total = atoi(optarg);
@@ -169,13 +534,22 @@ int main(int argc, char **argv)
 			start = atof(optarg);
 			hasStart = true;
 			break;
+		case 'p':
+			threads = atoi(optarg);
+			break;
+		case 'F':
+			tolerance = atof(optarg);
+			break;
+		case 'c':
+			chunk = atoi(optarg);
+			break;
 		default: /* '?' */
 			usage(argv[0]);
 			return 1;
 		}
 	}
 
-	if (file == "" || total == 0 || mode == "") {
+	if (files.size() == 0 || total == 0 || mode == "") {
 		usage(argv[0]);
 		return 2;
 	}
@@ -185,29 +559,57 @@ int main(int argc, char **argv)
 		return 2;
 	}
 
+	if (mode != "real" && tolerance > 0) {
+		usage(argv[0],"-F needs real mode");
+		return 2;
+	}
+
+	SizeType npthreads = 1;
+	PsimagLite::Concurrency concurrency(&argc,&argv,npthreads);
+	PsimagLite::Concurrency::npthreads = threads;
+
+	RealType emin = 1e10;
+	RealType emax = -emin;
+	RealType wabsmax = 0;
+	VectorComplexType values(total,0.0);
+	if (chunk > 0) {
+		if (!hasStart || !hasStep) scan(emin,emax,wabsmax,files,chunk);
+
+		RealType omegaInit = (hasStart) ? start : emin;
+		RealType omegaStep = (hasStep) ? step : (emax-omegaInit)/(total-1);
+		wabsmax = 0;
+		stream(values,wabsmax,files,chunk,omegaStep,omegaInit,eps,beta,mode,tolerance);
+		print(values,1.0/wabsmax,omegaStep,omegaInit,eps,beta,mode);
+		return 0;
+	}
+
 	// load
 	VectorRealType e;
 	VectorRealType w;
-	load(e,w,file);
+	load(e,w,files);
 	// sort
 	sort(e,w);
 	// min, max, prune
-	RealType emin = 1e10;
-	RealType emax = -emin;
-	RealType wabsmax = 0;
 	prune(e,w,emin,emax,wabsmax);
 
 	RealType omegaInit = (hasStart) ? start : emin;
 	RealType omegaStep = (emax-omegaInit)/(total-1);
 	if (hasStep) omegaStep = step;
-	RealType factor = 1.0/wabsmax;
 
-	for (SizeType i = 0; i < total; ++i) {
-		ComplexType z = findOmega(i,total,omegaStep,omegaInit,eps,beta,mode);
-		RealType omega = (mode == "real") ? std::real(z) : std::imag(z);
-		ComplexType val = lorentzian(z,e,w);
-		val *= factor;
-		std::cout<<omega<<" "<<std::real(val)<<" "<<std::imag(val)<<"\n";
-	}
+	LorentzianFft* fftPtr = 0;
+	if (tolerance > 0 && e.size() > 0)
+		fftPtr = new LorentzianFft(total,
+		                           omegaStep,
+		                           omegaInit,
+		                           eps,
+		                           tolerance,
+		                           e[0],
+		                           e[e.size() - 1]);
+
+	accumulate(values,e,w,omegaStep,omegaInit,eps,beta,mode,fftPtr);
+	if (fftPtr) fftPtr->finalize(values);
+	delete fftPtr;
+
+	print(values,1.0/wabsmax,omegaStep,omegaInit,eps,beta,mode);
 }
 
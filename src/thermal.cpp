@@ -1,14 +1,22 @@
 #include "OneSector.h"
+#include "PoleFile.h"
 #include "IoSimple.h"
 #include "Tokenizer.h"
+#include "Concurrency.h"
+#include "Parallelizer.h"
+#include "InputCheck.h"
 
 typedef double RealType;
 typedef PsimagLite::IoSimple::In InputType;
 typedef LanczosPlusPlus::OneSector<RealType,InputType> OneSectorType;
+typedef OneSectorType::SectorArchiveType SectorArchiveType;
 typedef PsimagLite::Vector<OneSectorType*>::Type VectorOneSectorType;
 typedef PsimagLite::Vector<RealType>::Type VectorRealType;
+typedef PsimagLite::Vector<VectorRealType>::Type VectorVectorRealType;
 typedef OneSectorType::VectorSizeType VectorSizeType;
 typedef OneSectorType::MatrixType MatrixType;
+typedef OneSectorType::SparseMatrixType SparseMatrixType;
+typedef LanczosPlusPlus::PoleFileWriter<RealType> PoleFileWriterType;
 
 struct ThermalOptions {
 	ThermalOptions(PsimagLite::String operatorName_,
@@ -28,15 +36,16 @@ struct ThermalOptions {
 	RealType mu;
 	RealType constant;
 	VectorSizeType sites;
+	PsimagLite::String polesFile;
 };
 
 //Compute X^(s,s')_{n,n'} = \sum_{t,t'}U^{s*}_{n,t}A_{t,t'}^(s,s')U^{s'}_{t',n'}
 void computeX(MatrixType& x,
-              const MatrixType& a,
+              const SparseMatrixType& a,
               const OneSectorType& sectorSrc,
               const OneSectorType& sectorDest)
 {
-	MatrixType tmp(x.n_row(),x.n_col());
+	MatrixType tmp(a.row(),sectorDest.size());
 	sectorDest.multiplyRight(tmp,a);
 	sectorSrc.multiplyLeft(x,tmp);
 }
@@ -53,42 +62,117 @@ SizeType findJnd(const VectorOneSectorType& sectors, const VectorSizeType& jndVe
 	throw PsimagLite::RuntimeError(str);
 }
 
-void findOperatorAndMatrix(MatrixType& a,
-                           SizeType& jnd,
-                           SizeType siteIndex,
-                           SizeType ind,
-                           const ThermalOptions& opt,
-                           const VectorOneSectorType& sectors,
-                           InputType& io)
+// Returns true for the identity, which needs no input
+bool findIdentity(SparseMatrixType& a,
+                  SizeType& jnd,
+                  SizeType ind,
+                  const ThermalOptions& opt,
+                  const VectorOneSectorType& sectors)
 {
 	if (opt.operatorName == "i") {
 		jnd = ind;
-		SizeType n = sectors[ind]->size();
+		SizeType n = sectors[ind]->basisSize();
 		a.resize(n,n);
-		a.setTo(0);
-		for (SizeType i = 0; i < n; ++i)
-			a(i,i) = 1.0;
+		for (SizeType i = 0; i < n; ++i) {
+			a.setRow(i,i);
+			a.pushCol(i);
+			a.pushValue(1.0);
+		}
 
-		return;
-	} else if (opt.operatorName != "c") {
+		a.setRow(n,n);
+		a.checkValidity();
+
+		return true;
+	} else if (opt.operatorName != "c" && opt.operatorName != "sz") {
 		PsimagLite::String str(__FILE__);
 		str += " " + ttos(__LINE__) + "\n";
 		str += "findOperatorAndMatrix: unknown operator " + opt.operatorName + "\n";
 		throw PsimagLite::RuntimeError(str);
 	}
 
+	return false;
+}
+
+// Heisenberg dumps Sz, the fermionic models dump c with spin up
+PsimagLite::String archivedName(const ThermalOptions& opt)
+{
+	return (opt.operatorName == "sz") ? "Sz" : "c";
+}
+
+void findOperatorAndMatrix(SparseMatrixType& a,
+                           SizeType& jnd,
+                           SizeType siteIndex,
+                           SizeType ind,
+                           const ThermalOptions& opt,
+                           const VectorOneSectorType& sectors,
+                           InputType& io)
+{
+	if (findIdentity(a,jnd,ind,opt,sectors)) return;
+
 	SizeType spin = 0;
 	assert(opt.sites.size() > siteIndex);
 	SizeType site = opt.sites[siteIndex];
-	PsimagLite::String label = "#Operator_c_";
-	label += ttos(spin) + "_" + ttos(site);
+	PsimagLite::String label = "#Operator_" + archivedName(opt) + "_";
+	// Sz has no spin, and is printed as #Operator_Sz__site
+	if (opt.operatorName != "sz") label += ttos(spin);
+	label += "_" + ttos(site);
 	io.advance(label,0);
 	VectorSizeType jndVector;
 	io.read(jndVector,"#SectorDest");
 	if (jndVector.size() == 0) return;
 	jnd = findJnd(sectors,jndVector);
 
-	io.readMatrix(a,"#Matrix");
+	// (row, col, value) triplets ordered by row
+	VectorSizeType size;
+	VectorSizeType rows;
+	VectorSizeType cols;
+	VectorRealType values;
+	io.read(size,"#MatrixSize");
+	io.read(rows,"#MatrixRows");
+	io.read(cols,"#MatrixCols");
+	io.read(values,"#MatrixValues");
+	SizeType total = values.size();
+	if (size.size() != 2 || rows.size() != total || cols.size() != total) {
+		PsimagLite::String str(__FILE__);
+		str += " " + ttos(__LINE__) + "\n";
+		str += "findOperatorAndMatrix: malformed operator " + label + "\n";
+		throw PsimagLite::RuntimeError(str);
+	}
+
+	LanczosPlusPlus::SectorArchiveFormat::fromTriplets(a,
+	                                                   size[0],
+	                                                   size[1],
+	                                                   (total > 0) ? &(rows[0]) : 0,
+	                                                   (total > 0) ? &(cols[0]) : 0,
+	                                                   (total > 0) ? &(values[0]) : 0,
+	                                                   total);
+}
+
+// Same as above, but from the binary archive
+void findOperatorAndMatrix(SparseMatrixType& a,
+                           SizeType& jnd,
+                           SizeType siteIndex,
+                           SizeType ind,
+                           const ThermalOptions& opt,
+                           const VectorOneSectorType& sectors,
+                           const SectorArchiveType& archive)
+{
+	if (findIdentity(a,jnd,ind,opt,sectors)) return;
+
+	SizeType spin = 0;
+	assert(opt.sites.size() > siteIndex);
+	SizeType site = opt.sites[siteIndex];
+	int destNup = -1;
+	int destNdown = -1;
+	if (!archive.getOperator(a,destNup,destNdown,ind,archivedName(opt),spin,site)) {
+		a = SparseMatrixType();
+		return;
+	}
+
+	VectorSizeType jndVector(2,0);
+	jndVector[0] = destNup;
+	jndVector[1] = destNdown;
+	jnd = findJnd(sectors,jndVector);
 }
 
 RealType computePartialZ(SizeType ind,
@@ -123,27 +207,31 @@ RealType computePartialE(SizeType ind,
 	return sum;
 }
 
-RealType computeThisSector(SizeType ind,
-                           const ThermalOptions& opt,
-                           const VectorOneSectorType& sectors,
-                           InputType& io,
-                           RealType factor,
-                           RealType zInverse)
+// Returns false if sector ind does not contribute
+template<typename SourceType>
+bool computeXY(MatrixType& x,
+               MatrixType& y,
+               SizeType& jnd,
+               SizeType ind,
+               const ThermalOptions& opt,
+               const VectorOneSectorType& sectors,
+               SourceType& io)
 {
-	SizeType jnd = 0;
-	MatrixType a;
+	jnd = 0;
+	SparseMatrixType a;
 	findOperatorAndMatrix(a,jnd,0,ind,opt,sectors,io);
 
-	SizeType n = a.n_row();
-	if (n == 0) return 0.0;
-	assert(n == sectors[ind]->size());
+	if (a.row() == 0 || a.col() == 0) return false;
+	assert(a.row() == sectors[ind]->basisSize());
+	assert(a.col() == sectors[jnd]->basisSize());
 
-	SizeType m = a.n_col();
-	assert(m == sectors[jnd]->size());
-	if (m == 0) return 0.0;
+	// eigenstates kept in each sector, fewer than the basis size if truncated
+	SizeType n = sectors[ind]->size();
+	SizeType m = sectors[jnd]->size();
+	if (n == 0 || m == 0) return false;
 
 	//Read operator 2   --> B
-	MatrixType b;
+	SparseMatrixType b;
 	assert(opt.sites.size() == 2);
 	if (opt.sites[0] == opt.sites[1]) {
 		b = a;
@@ -161,11 +249,31 @@ RealType computeThisSector(SizeType ind,
 	}
 
 	//Compute X^(s,s')_{n,n'} = \sum_{t,t'}U^{s*}_{n,t}A_{t,t'}^(s,s')U^{s'}_{t',n'}
-	MatrixType x(n,m);
+	x.resize(n,m);
 	computeX(x,a,*(sectors[ind]),*(sectors[jnd]));
 	// Same for Y from B
-	MatrixType y(n,m);
+	y.resize(n,m);
 	computeX(y,b,*(sectors[ind]),*(sectors[jnd]));
+	return true;
+}
+
+template<typename SourceType>
+RealType computeThisSector(SizeType ind,
+                           const ThermalOptions& opt,
+                           const VectorOneSectorType& sectors,
+                           SourceType& io,
+                           RealType factor,
+                           RealType zInverse,
+                           VectorRealType& poles,
+                           std::ostream& osInfo)
+{
+	SizeType jnd = 0;
+	MatrixType x;
+	MatrixType y;
+	if (!computeXY(x,y,jnd,ind,opt,sectors,io)) return 0.0;
+
+	SizeType n = x.n_row();
+	SizeType m = x.n_col();
 	// Result is
 	// \sum_{n,n'} X_{n,n'} Y_{n',n} exp(-i(E_n'-E_n)t))exp(-beta E_n)
 	RealType sum = 0.0;
@@ -177,7 +285,8 @@ RealType computeThisSector(SizeType ind,
 			RealType arg = opt.beta*(factor-e1);
 			RealType val = x(i,j)*PsimagLite::conj(y(i,j))* exp(arg)*zInverse;
 			if (opt.operatorName != "i" && fabs(val)>1e-12) {
-				std::cout<<(e1-e2+opt.mu)<<" "<<val<<"\n";
+				poles.push_back(e1-e2+opt.mu);
+				poles.push_back(val);
 				counter++;
 			}
 
@@ -185,31 +294,338 @@ RealType computeThisSector(SizeType ind,
 		}
 	}
 
-	std::cerr<<"Sector "<<ind<<" found "<<counter<<" values, sum="<<sum<<"\n";
+	osInfo<<"Sector "<<ind<<" found "<<counter<<" values, sum="<<sum<<"\n";
 	return sum;
 }
 
-void computeAverageFor(const ThermalOptions& opt,
+// W_n = \sum_{n'} X_{n,n'} conj(Y_{n,n'}) does not depend on beta or mu
+template<typename SourceType>
+void computeWeights(VectorRealType& w,
+                    SizeType ind,
+                    const ThermalOptions& opt,
+                    const VectorOneSectorType& sectors,
+                    SourceType& io)
+{
+	SizeType jnd = 0;
+	MatrixType x;
+	MatrixType y;
+	w.clear();
+	if (!computeXY(x,y,jnd,ind,opt,sectors,io)) return;
+
+	w.resize(x.n_row(),0.0);
+	for (SizeType i = 0; i < x.n_row(); ++i)
+		for (SizeType j = 0; j < x.n_col(); ++j)
+			w[i] += x(i,j)*PsimagLite::conj(y(i,j));
+}
+
+// Poles go to opt.polesFile in binary if given, else to standard output
+void printPoles(const VectorRealType& poles, PoleFileWriterType* writer)
+{
+	if (writer) {
+		writer->write(poles);
+		return;
+	}
+
+	for (SizeType i = 0; i < poles.size(); i += 2)
+		std::cout<<poles[i]<<" "<<poles[i + 1]<<"\n";
+}
+
+// One task per source sector; each task needs only its source sector, one
+// destination sector and its operators, all read in place from the archive.
+// Sectors are done in windows of consecutive sectors; the results of a window
+// are written and reduced in sector order before the next window starts,
+// so that the output does not depend on the number of threads, and only
+// the poles of one window are held in memory.
+class CorrelatorTasks {
+
+public:
+
+	enum TaskEnum {TASK_SUMS, TASK_WEIGHTS};
+
+	CorrelatorTasks(const ThermalOptions& opt,
+	                const VectorOneSectorType& sectors,
+	                const SectorArchiveType& archive,
+	                const VectorRealType& muFactors,
+	                RealType zInverse,
+	                SizeType window)
+	    : task_(TASK_SUMS),
+	      opt_(opt),
+	      sectors_(sectors),
+	      archive_(archive),
+	      muFactors_(muFactors),
+	      zInverse_(zInverse),
+	      offset_(0),
+	      sums_(window,0.0),
+	      poles_(window),
+	      info_(window),
+	      weights_(0)
+	{}
+
+	// Only the weights W_n of each sector, for grids of beta and mu
+	CorrelatorTasks(const ThermalOptions& opt,
+	                const VectorOneSectorType& sectors,
+	                const SectorArchiveType& archive,
+	                VectorVectorRealType& weights)
+	    : task_(TASK_WEIGHTS),
+	      opt_(opt),
+	      sectors_(sectors),
+	      archive_(archive),
+	      muFactors_(emptyVector_),
+	      zInverse_(0),
+	      offset_(0),
+	      weights_(&weights)
+	{
+		weights.resize(sectors.size());
+	}
+
+	void thread_function_(SizeType threadNum,
+	                      SizeType blockSize,
+	                      SizeType total,
+	                      PsimagLite::Concurrency::MutexType*)
+	{
+		for (SizeType p = 0; p < blockSize; ++p) {
+			SizeType taskNumber = threadNum*blockSize + p;
+			if (taskNumber >= total) break;
+			if (task_ == TASK_WEIGHTS) {
+				computeWeights((*weights_)[taskNumber],taskNumber,opt_,sectors_,archive_);
+				continue;
+			}
+
+			SizeType ind = offset_ + taskNumber;
+			PsimagLite::OstringStream osInfo;
+			sums_[taskNumber] = computeThisSector(ind,
+			                                      opt_,
+			                                      sectors_,
+			                                      archive_,
+			                                      muFactors_[ind],
+			                                      zInverse_,
+			                                      poles_[taskNumber],
+			                                      osInfo);
+			info_[taskNumber] = osInfo.str();
+		}
+	}
+
+	// The next window starts at sector offset
+	void setOffset(SizeType offset) { offset_ = offset; }
+
+	// Writes the first total sectors of the window and frees their poles
+	RealType print(PoleFileWriterType* writer, std::ostream& osInfo, SizeType total)
+	{
+		assert(total <= sums_.size());
+		RealType sum = 0.0;
+		for (SizeType i = 0; i < total; ++i) {
+			printPoles(poles_[i],writer);
+			osInfo<<info_[i];
+			sum += sums_[i];
+			VectorRealType().swap(poles_[i]);
+			info_[i] = "";
+		}
+
+		return sum;
+	}
+
+private:
+
+	static const VectorRealType emptyVector_;
+
+	TaskEnum task_;
+	const ThermalOptions& opt_;
+	const VectorOneSectorType& sectors_;
+	const SectorArchiveType& archive_;
+	const VectorRealType& muFactors_;
+	RealType zInverse_;
+	SizeType offset_;
+	VectorRealType sums_;
+	VectorVectorRealType poles_;
+	PsimagLite::Vector<PsimagLite::String>::Type info_;
+	VectorVectorRealType* weights_;
+}; // class CorrelatorTasks
+
+const VectorRealType CorrelatorTasks::emptyVector_;
+
+// The text format has no index, so its operators are read in file order
+RealType computeAllSectors(const ThermalOptions& opt,
+                           const VectorOneSectorType& sectors,
+                           InputType& io,
+                           const VectorRealType& muFactors,
+                           RealType zInverse,
+                           PoleFileWriterType* writer)
+{
+	io.rewind();
+	RealType sum = 0.0;
+	for (SizeType i = 0; i < sectors.size(); ++i) {
+		VectorRealType poles;
+		sum += computeThisSector(i,opt,sectors,io,muFactors[i],zInverse,poles,std::cerr);
+		printPoles(poles,writer);
+	}
+
+	return sum;
+}
+
+RealType computeAllSectors(const ThermalOptions& opt,
+                           const VectorOneSectorType& sectors,
+                           const SectorArchiveType& archive,
+                           const VectorRealType& muFactors,
+                           RealType zInverse,
+                           PoleFileWriterType* writer)
+{
+	typedef PsimagLite::Parallelizer<CorrelatorTasks> ParallelizerType;
+
+	// a few sectors per thread, so that threads rarely wait for a slow sector
+	SizeType window = 4*PsimagLite::Concurrency::npthreads;
+	CorrelatorTasks tasks(opt,sectors,archive,muFactors,zInverse,window);
+	ParallelizerType threaded(PsimagLite::Concurrency::npthreads,
+	                          PsimagLite::MPI::COMM_WORLD);
+	RealType sum = 0.0;
+	for (SizeType offset = 0; offset < sectors.size(); offset += window) {
+		SizeType total = std::min(window,sectors.size() - offset);
+		tasks.setOffset(offset);
+		threaded.loopCreate(total,tasks);
+		sum += tasks.print(writer,std::cerr,total);
+	}
+
+	return sum;
+}
+
+void computeAllWeights(VectorVectorRealType& weights,
+                       const ThermalOptions& opt,
                        const VectorOneSectorType& sectors,
                        InputType& io)
+{
+	io.rewind();
+	weights.resize(sectors.size());
+	for (SizeType i = 0; i < sectors.size(); ++i)
+		computeWeights(weights[i],i,opt,sectors,io);
+}
+
+void computeAllWeights(VectorVectorRealType& weights,
+                       const ThermalOptions& opt,
+                       const VectorOneSectorType& sectors,
+                       const SectorArchiveType& archive)
+{
+	typedef PsimagLite::Parallelizer<CorrelatorTasks> ParallelizerType;
+
+	CorrelatorTasks tasks(opt,sectors,archive,weights);
+	ParallelizerType threaded(PsimagLite::Concurrency::npthreads,
+	                          PsimagLite::MPI::COMM_WORLD);
+	threaded.loopCreate(sectors.size(),tasks);
+}
+
+// Number of particles of each sector
+void computeParticles(VectorRealType& particles, const VectorOneSectorType& sectors)
+{
+	particles.resize(sectors.size());
+	for (SizeType i = 0; i < sectors.size(); ++i) {
+		const VectorSizeType& nupAndDown = sectors[i]->sector();
+		if (nupAndDown.size() != 2) {
+			throw PsimagLite::RuntimeError("#SectorSource\n");
+		}
+
+		particles[i] = nupAndDown[0] + nupAndDown[1];
+	}
+}
+
+// Operator matrices are read and rotated once for the whole grid: only the
+// weights W_n of computeWeights are kept. For each beta, the sums over the
+// eigenstates of a sector are shifted by the lowest energy of the sector;
+// for each mu, sectors are combined with a common shift, so that
+// exp never overflows at low temperature.
+template<typename SourceType>
+void computeGrid(const ThermalOptions& opt,
+                 const VectorRealType& betas,
+                 const VectorRealType& mus,
+                 const VectorOneSectorType& sectors,
+                 SourceType& io)
+{
+	bool hasCorrelator = (opt.sites.size() == 2);
+	VectorVectorRealType weights;
+	if (hasCorrelator) computeAllWeights(weights,opt,sectors,io);
+
+	SizeType total = sectors.size();
+	VectorRealType particles;
+	computeParticles(particles,sectors);
+
+	std::cout<<"#beta mu density energy lnZ";
+	if (hasCorrelator) {
+		std::cout<<" "<<opt.operatorName<<"_"<<opt.sites[0];
+		std::cout<<"_"<<opt.operatorName<<"_"<<opt.sites[1];
+	}
+
+	std::cout<<"\n";
+
+	VectorRealType zs(total);
+	VectorRealType es(total);
+	VectorRealType ws(total);
+	VectorRealType exponents(total);
+	for (SizeType ib = 0; ib < betas.size(); ++ib) {
+		RealType beta = betas[ib];
+		for (SizeType i = 0; i < total; ++i) {
+			zs[i] = es[i] = ws[i] = 0.0;
+			SizeType n = sectors[i]->size();
+			if (n == 0) continue;
+			RealType e0 = sectors[i]->eig(0);
+			bool hasWeights = (hasCorrelator && weights[i].size() == n);
+			for (SizeType j = 0; j < n; ++j) {
+				RealType e1 = sectors[i]->eig(j);
+				RealType tmp = exp(-beta*(e1 - e0));
+				zs[i] += tmp;
+				es[i] += tmp*e1;
+				if (hasWeights) ws[i] += tmp*weights[i][j];
+			}
+		}
+
+		for (SizeType im = 0; im < mus.size(); ++im) {
+			RealType mu = mus[im];
+			RealType maxExponent = 0.0;
+			bool first = true;
+			for (SizeType i = 0; i < total; ++i) {
+				if (sectors[i]->size() == 0) continue;
+				exponents[i] = beta*(mu*particles[i] + opt.constant - sectors[i]->eig(0));
+				if (!first && exponents[i] <= maxExponent) continue;
+				maxExponent = exponents[i];
+				first = false;
+			}
+
+			RealType z = 0.0;
+			RealType numerator = 0.0;
+			RealType energy = 0.0;
+			RealType sum = 0.0;
+			for (SizeType i = 0; i < total; ++i) {
+				if (sectors[i]->size() == 0) continue;
+				RealType factor = exp(exponents[i] - maxExponent);
+				z += factor*zs[i];
+				numerator += factor*zs[i]*particles[i];
+				energy += factor*es[i];
+				sum += factor*ws[i];
+			}
+
+			std::cout<<beta<<" "<<mu<<" "<<(numerator/z)<<" "<<(energy/z);
+			std::cout<<" "<<(log(z) + maxExponent);
+			if (hasCorrelator) std::cout<<" "<<(sum/z);
+			std::cout<<"\n";
+		}
+	}
+}
+
+// SourceType is InputType for text or SectorArchiveType for binary
+template<typename SourceType>
+void computeAverageFor(const ThermalOptions& opt,
+                       const VectorOneSectorType& sectors,
+                       SourceType& io)
 {
 	ThermalOptions optZ = opt;
 	optZ.operatorName = "i";
-	VectorSizeType nupAndDown;
 	VectorRealType muFactors(sectors.size(),0);
+	VectorRealType particles;
+	computeParticles(particles,sectors);
 
 	RealType zPartition = 0.0;
 	RealType numerator = 0.0;
 	RealType energy = 0.0;
 	for (SizeType i = 0; i < sectors.size(); ++i) {
-		io.read(nupAndDown,"#SectorSource");
-		if (nupAndDown.size() != 2) {
-			throw PsimagLite::RuntimeError("#SectorSource\n");
-		}
-
-		muFactors[i] = opt.mu*(nupAndDown[0] + nupAndDown[1])+opt.constant;
+		muFactors[i] = opt.mu*particles[i] + opt.constant;
 		RealType tmp = computePartialZ(i,optZ,sectors,muFactors[i]);
-		numerator += tmp*(nupAndDown[0] + nupAndDown[1]);
+		numerator += tmp*particles[i];
 		energy += computePartialE(i,optZ,sectors,muFactors[i]);
 		zPartition += tmp;
 	}
@@ -220,22 +636,46 @@ void computeAverageFor(const ThermalOptions& opt,
 
 	if (opt.sites.size() < 2) return;
 
-	io.rewind();
-	RealType sum = 0.0;
-	for (SizeType i = 0; i < sectors.size(); ++i) {
-		sum += computeThisSector(i,opt,sectors,io,muFactors[i],zInverse);
-	}
+	PoleFileWriterType* writer = 0;
+	if (opt.polesFile != "") writer = new PoleFileWriterType(opt.polesFile);
+
+	RealType sum = computeAllSectors(opt,sectors,io,muFactors,zInverse,writer);
+	delete writer;
 
 	std::cerr<<"operator="<<opt.operatorName;
 	std::cerr<<" beta="<<opt.beta<<" mu="<<opt.mu;
 	std::cerr<<" partition="<<zPartition<<" sum="<<sum<<"\n";
 }
 
+// A single beta and mu give the old output; lists of them give a grid
+template<typename SourceType>
+void computeFor(const ThermalOptions& opt,
+                const VectorRealType& betas,
+                const VectorRealType& mus,
+                const VectorOneSectorType& sectors,
+                SourceType& io)
+{
+	if (betas.size() == 1 && mus.size() == 1)
+		computeAverageFor(opt,sectors,io);
+	else
+		computeGrid(opt,betas,mus,sectors,io);
+}
+
+void readList(VectorRealType& v, PsimagLite::String str)
+{
+	PsimagLite::Vector<PsimagLite::String>::Type tokens;
+	PsimagLite::tokenizer(str,tokens,",");
+	v.resize(tokens.size());
+	for (SizeType i = 0; i < tokens.size(); ++i)
+		v[i] = atof(tokens[i].c_str());
+}
+
 void usage(char *name, PsimagLite::String msg = "")
 {
 	if (msg != "") std::cerr<<name<<": "<<msg<<"\n";
-	std::cerr<<"USAGE: "<<name<<" -f file -c operator -b beta ";
-	std::cerr<<" -s site1[,site2] [-m mu] [-C constant]\n";
+	std::cerr<<"USAGE: "<<name<<" -f file -c operator -b beta[,beta2,...] ";
+	std::cerr<<" -s site1[,site2] [-m mu[,mu2,...]] [-C constant] [-t threads]";
+	std::cerr<<" [-P polesFile]\n";
 }
 
 int main(int argc, char**argv)
@@ -245,11 +685,39 @@ int main(int argc, char**argv)
 	PsimagLite::String file;
 	PsimagLite::Vector<PsimagLite::String>::Type tokens;
 	VectorSizeType sites(2,0);
-	RealType beta = 0;
-	RealType mu = 0;
+	VectorRealType betas(1,0);
+	VectorRealType mus(1,0);
 	RealType constant = 0;
-
-	while ((opt = getopt(argc, argv, "f:c:b:s:m:C:")) != -1) {
+	SizeType threads = 1;
+	PsimagLite::String polesFile;
+
+	/* PSIDOC ThermalDriver
+	Thermal averages from the output of SolverOptions=dumpmatrix for all sectors,
+	either the text file made by scripts/grandCanonical.pl or the binary archive of
+	DumpArchive=, which is recognized automatically.
+	\begin{itemize}
+	\item[-f file] Text dump or binary archive.
+	\item[-c operator] Either c, sz (for the Heisenberg model), or i (identity).
+	\item[-b beta] Inverse temperature, or a comma-separated list of them.
+	\item[-s site1,site2] Sites of the correlator.
+	\item[-m mu] Chemical potential, or a comma-separated list of them.
+	\item[-C constant] Constant added to the energies.
+	\item[-t threads] Sectors of a binary archive are processed in parallel with this
+	many threads; each thread holds only the matrices of one pair of sectors,
+	and poles are written out every few sectors per thread, in sector order.
+	The results do not depend on the number of threads.
+	A text dump is read and processed sequentially, with the matrices of all
+	sectors held in memory, whatever -t is; only the binary archive scales
+	with threads and memory, so large dumps should use DumpArchive=.
+	\item[-P file] Poles and weights of the correlator are written in binary to
+	this file instead of printed to standard output; lorentzian reads them.
+	\end{itemize}
+	If more than one beta or mu is given, operators are read and rotated into the
+	eigenbasis only once, and one line per pair (beta, mu) is printed to
+	standard output with columns beta, mu, density, energy, $\ln Z$ and, if two
+	sites are given, the equal-time correlator.
+	*/
+	while ((opt = getopt(argc, argv, "f:c:b:s:m:C:t:P:")) != -1) {
 		switch (opt) {
 		case 'c':
 			operatorName = optarg;
@@ -258,17 +726,23 @@ int main(int argc, char**argv)
 			file = optarg;
 			break;
 		case 'b':
-			beta = atof(optarg);
+			readList(betas,optarg);
 			break;
 		case 's':
 			PsimagLite::tokenizer(optarg,tokens,",");
 			break;
 		case 'm':
-			mu = atof(optarg);
+			readList(mus,optarg);
 			break;
 		case 'C':
 			constant = atof(optarg);
 			break;
+		case 't':
+			threads = atoi(optarg);
+			break;
+		case 'P':
+			polesFile = optarg;
+			break;
 		default: /* '?' */
 			usage(argv[0]);
 			return 1;
@@ -280,6 +754,11 @@ int main(int argc, char**argv)
 		return 2;
 	}
 
+	if (betas.size() == 0 || mus.size() == 0) {
+		usage(argv[0],"Empty list of beta or mu");
+		return 2;
+	}
+
 	if (tokens.size() > sites.size()) {
 		usage(argv[0],"Too many sites");
 		return 3;
@@ -294,6 +773,32 @@ int main(int argc, char**argv)
 		usage(argv[0],"site1 must be smaller than site2");
 	}
 
+	ThermalOptions options(operatorName,betas[0],mus[0],constant,sites);
+	options.polesFile = polesFile;
+
+	SizeType npthreads = 1;
+	PsimagLite::Concurrency concurrency(&argc,&argv,npthreads);
+	PsimagLite::Concurrency::npthreads = threads;
+	LanczosPlusPlus::InputCheck inputCheck;
+	inputCheck.checkForThreads(PsimagLite::Concurrency::npthreads);
+
+	// Only the archive is processed in parallel; sectors are views into the mapping
+	if (SectorArchiveType::isArchive(file)) {
+		SectorArchiveType archive(file);
+		VectorOneSectorType sectors(archive.sectors());
+		for (SizeType i = 0; i < sectors.size(); ++i)
+			sectors[i] = new OneSectorType(archive,i);
+
+		computeFor(options,betas,mus,sectors,archive);
+
+		for (SizeType i = 0; i < sectors.size(); ++i)
+			delete sectors[i];
+		return 0;
+	}
+
+	if (PsimagLite::Concurrency::npthreads > 1)
+		std::cerr<<argv[0]<<": WARNING: -t is ignored for a text dump\n";
+
 	InputType io(file);
 	SizeType total = 0;
 	io.readline(total,"#TotalSectors=");
@@ -304,9 +809,8 @@ int main(int argc, char**argv)
 		//sectors[i]->info(std::cout);
 	}
 
-	ThermalOptions options(operatorName,beta,mu,constant,sites);
 	io.rewind();
-	computeAverageFor(options,sectors,io);
+	computeFor(options,betas,mus,sectors,io);
 
 	for (SizeType i = 0; i < sectors.size(); ++i)
 		delete sectors[i];
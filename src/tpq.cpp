@@ -0,0 +1,211 @@
+#include "AllocatorCpu.h"
+#include "Version.h"
+#include "../../PsimagLite/src/Version.h"
+PsimagLite::String license = "Copyright (c) 2009-2017, UT-Battelle, LLC\n"
+                             "All rights reserved\n"
+                             "\n"
+                             "[Lanczos++, Version 1.0]\n"
+                             "\n"
+                             "-------------------------------------------------------------\n"
+                             "THE SOFTWARE IS SUPPLIED BY THE COPYRIGHT HOLDERS AND\n"
+                             "CONTRIBUTORS \"AS IS\" AND ANY EXPRESS OR IMPLIED\n"
+                             "WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED\n"
+                             "WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A\n"
+                             "PARTICULAR PURPOSE ARE DISCLAIMED. \n"
+                             "\n"
+                             "Please see full open source license included in file LICENSE.\n"
+                             "-------------------------------------------------------------\n"
+                             "\n";
+
+#include <unistd.h>
+#include <cstdlib>
+#include <getopt.h>
+#include "Concurrency.h"
+#include "ProgramGlobals.h"
+#include "ModelSelector.h"
+#include "Geometry/Geometry.h"
+#include "InternalProductOnTheFly.h"
+#include "InternalProductStored.h"
+#include "InputNg.h" // in PsimagLite
+#include "InputCheck.h"
+#include "DefaultSymmetry.h"
+#include "ThermalPureQuantum.h"
+
+using namespace LanczosPlusPlus;
+
+#ifndef USE_FLOAT
+typedef double RealType;
+#else
+typedef float RealType;
+#endif
+
+typedef std::complex<RealType> ComplexType;
+
+#ifdef USE_COMPLEX
+typedef ComplexType ComplexOrRealType;
+#else
+typedef RealType ComplexOrRealType;
+#endif
+
+typedef PsimagLite::Concurrency ConcurrencyType;
+typedef PsimagLite::InputNg<InputCheck> InputNgType;
+typedef PsimagLite::Geometry<ComplexOrRealType,
+InputNgType::Readable,
+ProgramGlobals> GeometryType;
+typedef ModelSelector<ComplexOrRealType,GeometryType,InputNgType::Readable> ModelSelectorType;
+typedef ModelSelectorType::ModelBaseType ModelBaseType;
+typedef ModelBaseType::BasisBaseType BasisBaseType;
+typedef DefaultSymmetry<GeometryType,BasisBaseType> DefaultSymmetryType;
+typedef TpqParams<RealType> TpqParamsType;
+
+void usage(const char* name)
+{
+	std::cerr<<"USAGE: "<<name<<" -f file [-m] [-l l] [-b betaStep] [-R samples] ";
+	std::cerr<<"[-M steps] [-S seed] [-k krylovSteps] [-e tolerance] ";
+	std::cerr<<"[-c n|sz -s site] [-p precision]\n";
+}
+
+template<template<typename,typename> class InternalProductTemplate>
+void mainLoop(const ModelBaseType& model, const TpqParamsType& params)
+{
+	typedef InternalProductTemplate<ModelBaseType,DefaultSymmetryType> InternalProductType;
+	typedef ThermalPureQuantum<ModelBaseType,InternalProductType> ThermalPureQuantumType;
+
+	if (model.name().find("Heisenberg.h") != PsimagLite::String::npos)
+		throw PsimagLite::RuntimeError("tpq: Heisenberg model not supported yet\n");
+
+	DefaultSymmetryType symm(model.basis(),model.geometry(),"");
+	InternalProductType matrix(model,model.basis(),symm);
+	ThermalPureQuantumType tpq(model,model.basis(),matrix,params);
+	tpq.print(std::cout);
+}
+
+int main(int argc,char *argv[])
+{
+	int opt = 0;
+	PsimagLite::String file = "";
+	TpqParamsType params;
+	InputCheck inputCheck;
+	int precision = 6;
+
+	/* PSIDOC TpqDriver
+	Thermal pure quantum (TPQ) states in the sector given by the input file.
+	Only matrix-vector products are needed, so it runs for the same
+	cluster sizes as the ground state.
+	In the canonical ensemble (the default) each random vector $|r\rangle$ is
+	propagated to $\exp(-\beta H/2)|r\rangle$ in steps of $\Delta\beta$
+	with the Krylov propagator, which holds krylovSteps vectors per sample.
+	With -m the microcanonical ensemble $(l-H/N)^k|r\rangle$ is used instead,
+	which holds two vectors per sample; l must be larger than the largest
+	energy per site, which is estimated with a few Lanczos steps before sampling,
+	and the inverse temperature of step k is $2k/(N(l-u_k))$.
+	The output has one line per temperature with beta,
+	the logarithm of the partition function (canonical only), the energy,
+	the specific heat $C=\beta^2\sigma^2$ with $\sigma^2=\langle H^2\rangle - \langle H\rangle^2$
+	(microcanonical: $C=\beta^2\sigma^2/(1-\beta^2\sigma^2/(2k))$, because the weight
+	$(l-E/N)^{2k}$ narrows the energy distribution of step k), and
+	optionally the static correlation $\langle O_i O_j\rangle$ for all j.
+	Samples are done in parallel if Threads= is
+	larger than one in the input file.
+	\begin{itemize}
+	\item[-f file] Input file.
+	\item[-m] Microcanonical TPQ.
+	\item[-l l] The constant l of the microcanonical TPQ (default 1).
+	\item[-b betaStep] The step $\Delta\beta$ of the canonical TPQ (default 0.1).
+	\item[-R samples] Random vectors (default 10).
+	\item[-M steps] Number of temperature steps (default 100).
+	\item[-S seed] Seed of the random number generator.
+	\item[-k steps] Maximum dimension of the Krylov space (default 20).
+	\item[-e tolerance] Error tolerance of the Krylov propagator (default $10^{-10}$).
+	\item[-c operator] Either n or sz; computes $\langle O_i O_j\rangle$.
+	\item[-s site] The site i above (default 0).
+	\item[-p precision] precision in decimals to use.
+	\end{itemize}
+	*/
+	while ((opt = getopt(argc, argv, "f:ml:b:R:M:S:k:e:c:s:p:")) != -1) {
+		switch (opt) {
+		case 'f':
+			file = optarg;
+			break;
+		case 'm':
+			params.ensemble = TpqParamsType::MICROCANONICAL;
+			break;
+		case 'l':
+			params.l = atof(optarg);
+			break;
+		case 'b':
+			params.betaStep = atof(optarg);
+			break;
+		case 'R':
+			params.samples = atoi(optarg);
+			break;
+		case 'M':
+			params.steps = atoi(optarg);
+			break;
+		case 'S':
+			params.seed = atol(optarg);
+			break;
+		case 'k':
+			params.krylovSteps = atoi(optarg);
+			break;
+		case 'e':
+			params.tolerance = atof(optarg);
+			break;
+		case 'c':
+			params.operatorName = optarg;
+			break;
+		case 's':
+			params.site = atoi(optarg);
+			break;
+		case 'p':
+			precision = atoi(optarg);
+			std::cout.precision(precision);
+			std::cerr.precision(precision);
+			break;
+		default: /* '?' */
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (file == "" || params.samples == 0 || params.betaStep <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	//! setup distributed parallelization
+	SizeType npthreads = 1;
+	ConcurrencyType concurrency(&argc,&argv,npthreads);
+
+	// print license
+	if (ConcurrencyType::root()) {
+		std::cerr<<license;
+		std::cerr<<"Lanczos++ Version "<<LANCZOSPP_VERSION<<"\n";
+		std::cerr<<"PsimagLite version "<<PSIMAGLITE_VERSION<<"\n";
+	}
+
+	InputNgType::Writeable ioWriteable(file,inputCheck);
+	InputNgType::Readable io(ioWriteable);
+	GeometryType geometry(io);
+
+	try {
+		io.readline(npthreads,"Threads=");
+		ConcurrencyType::npthreads = npthreads;
+	} catch (std::exception&) {}
+
+	inputCheck.checkForThreads(ConcurrencyType::npthreads);
+
+	ModelSelectorType modelSelector(io,geometry);
+	const ModelBaseType& model = modelSelector();
+	std::cout<<model;
+
+	PsimagLite::String tmp;
+	io.readline(tmp,"SolverOptions=");
+	bool onthefly = (tmp.find("InternalProductOnTheFly") != PsimagLite::String::npos);
+
+	if (onthefly)
+		mainLoop<InternalProductOnTheFly>(model,params);
+	else
+		mainLoop<InternalProductStored>(model,params);
+}
+